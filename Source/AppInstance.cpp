@@ -0,0 +1,1055 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "AppInstance.h"
+#include "AppOptions.h"
+#include "Shaders.h"
+#include "GLContext.h"
+#include "GLState.h"
+#include "Log.h"
+
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include <GLFW/glfw3.h>
+
+static struct
+{
+	std::mutex Mutex;
+	std::condition_variable CV;
+	uint64_t Count = 0;
+} FrameEvents;
+
+uint64_t GetFrameEventCount()
+{
+	std::unique_lock lock(FrameEvents.Mutex);
+	return FrameEvents.Count;
+}
+
+void NotifyFrameEvent()
+{
+	{
+		std::unique_lock lock(FrameEvents.Mutex);
+		FrameEvents.Count++;
+	}
+	FrameEvents.CV.notify_all();
+}
+
+bool WaitForFrameEvent(uint64_t seenCount, std::chrono::milliseconds timeout)
+{
+	std::unique_lock lock(FrameEvents.Mutex);
+	return FrameEvents.CV.wait_for(lock, timeout, [&]() { return FrameEvents.Count != seenCount; });
+}
+
+static nos::fb::UUID GenerateRandomUUID() {
+	nos::fb::UUID uuid;
+	std::vector<uint8_t> randomBytes(16);
+	std::random_device rd;
+	std::mt19937 gen(rd());
+	std::uniform_int_distribution<uint16_t> dis(0, std::numeric_limits<uint8_t>::max());
+
+	for (size_t i = 0; i < 16; ++i) {
+		randomBytes[i] = static_cast<uint8_t>(dis(gen));
+	}
+	memcpy(&uuid, randomBytes.data(), 16);
+	return uuid;
+}
+
+std::string GetTexturePinName(bool isOutput, uint32_t index)
+{
+	uint32_t count = isOutput ? g_Options.OutputCount : g_Options.InputCount;
+	std::string name = isOutput ? "Shader Output" : "Shader Input";
+	return count == 1 ? name : name + " " + std::to_string(index);
+}
+
+std::string GetBufferPinName(uint32_t index)
+{
+	return g_Options.BufferCount == 1 ? "Buffer Input" : "Buffer Input " + std::to_string(index);
+}
+
+// Outputs are always rendered as single level 2D textures
+static TextureShape GetPinShape(bool isOutput, uint32_t index)
+{
+	auto it = g_Options.InputShapes.find(index);
+	return isOutput || it == g_Options.InputShapes.end() ? TextureShape{} : it->second;
+}
+
+void SampleEventDelegates::HandleEvent(const nos::app::EngineEvent* event)
+{
+	using namespace nos::app;
+	if (Instance.EventLog)
+		Instance.EventLog->Record(event);
+	switch (event->event_type())
+	{
+	case EngineEventUnion::AppConnectedEvent: {
+		OnAppConnected(event->event_as<AppConnectedEvent>()->node());
+		break;
+	}
+	case EngineEventUnion::FullNodeUpdate: {
+		OnNodeUpdated(*event->event_as<nos::FullNodeUpdate>()->node());
+		break;
+	}
+	case EngineEventUnion::NodeRemovedEvent: {
+		OnNodeRemoved();
+		break;
+	}
+	case EngineEventUnion::AppPinValueChanged: {
+		auto const& pinValueChanged = event->event_as<AppPinValueChanged>();
+		OnPinValueChanged(*pinValueChanged->pin_id(),
+			pinValueChanged->value()->Data(),
+			pinValueChanged->value()->size(),
+			pinValueChanged->reset(),
+			pinValueChanged->frame_number());
+		break;
+	}
+	case EngineEventUnion::NodeImported: {
+		OnNodeImported(*event->event_as<nos::app::NodeImported>()->node());
+		break;
+	}
+
+	case EngineEventUnion::StateChanged: {
+		OnStateChanged(event->event_as<nos::app::StateChanged>()->state());
+		break;
+	}
+	case EngineEventUnion::AppExecuteStart: {
+		OnExecuteStart(event->event_as<nos::app::AppExecuteStart>());
+		break;
+	}
+	case EngineEventUnion::SyncSemaphoresFromNodos: {
+		OnSyncSemaphoresFromNodos(event->event_as<nos::app::SyncSemaphoresFromNodos>());
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void SampleEventDelegates::OnAppConnected(const nos::fb::Node* appNode)
+{
+	LogInfo("Instance ", Instance.Index, ": Connected to Nodos");
+	if (appNode)
+		Instance.CreateTexturePinsInNodos(*appNode);
+}
+
+void SampleEventDelegates::OnNodeUpdated(nos::fb::Node const& appNode)
+{
+	LogInfo("Instance ", Instance.Index, ": Node updated from Nodos");
+	Instance.CreateTexturePinsInNodos(appNode);
+}
+
+void SampleEventDelegates::OnNodeImported(nos::fb::Node const& appNode)
+{
+	LogInfo("Instance ", Instance.Index, ": Node updated from Nodos");
+	Instance.CreateTexturePinsInNodos(appNode);
+}
+
+void SampleEventDelegates::OnNodeRemoved()
+{
+	LogInfo("Instance ", Instance.Index, ": Node removed from Nodos");
+	Instance.Tasks.Push([this]()
+		{
+			Instance.ResetState();
+		});
+}
+
+void SampleEventDelegates::OnPinValueChanged(nos::fb::UUID const& pinId, uint8_t const* data, size_t size, bool reset, uint64_t frameNumber)
+{
+	// Which table the value holds depends on the pin's slot, which is only safe to look up on the render thread
+	Instance.Tasks.Push([this, pinId, value = std::vector<uint8_t>(data, data + size)]()
+		{
+			LogDebug("Instance ", Instance.Index, ": Pin value changed");
+			auto& state = Instance.State;
+			auto it = state.PinSlots.find(pinId);
+			if (it == state.PinSlots.end())
+				return;
+			auto [isOutput, isBuffer, index] = it->second;
+			if (isBuffer)
+			{
+				Instance.UpdateBufferPin(index, value.data());
+				return;
+			}
+			auto texRoot = flatbuffers::GetRoot<nos::sys::vulkan::Texture>(value.data());
+			if (!texRoot)
+			{
+				LogError("Failed to unpack texture");
+				return;
+			}
+			nos::sys::vulkan::TTexture tex{};
+			texRoot->UnPackTo(&tex);
+			auto& external = isOutput ? state.ShaderOutputs[index] : state.ShaderInputs[index];
+			// Stand-ins are counted as the allocation they replace
+			uint64_t bytes = tex.external_memory.allocation_size();
+			if (!Instance.ReserveMemory(bytes, external.ImportedBytes))
+			{
+				Instance.Stats.ImportFailures++;
+				// Nodos no longer uses the previous texture, stop rendering until a value that fits arrives
+				external.Image = {};
+				external.ImportedBytes = 0;
+				GetGLState().InvalidateBindings();
+				return;
+			}
+			// Replayed events carry handles from another process, stand in for them with local textures
+			auto shape = GetPinShape(isOutput, index);
+			MemoryImportHints hints{ .Dedicated = g_Options.ImportDedicated, .LinearTiling = g_Options.ImportLinearTiling };
+			auto imported = Client ? ImportTexture(Client, tex, shape, hints) : CreateStandInTexture(tex, shape);
+			if(!imported)
+			{
+				LogError("Failed to import texture");
+				Instance.Stats.ImportFailures++;
+				return;
+			}
+			Instance.Stats.TexturesImported++;
+			external.Texture = tex;
+			// Deletes the previous texture, whose name may come back bound to something else
+			external.Image = std::move(*imported);
+			GetGLState().InvalidateBindings();
+			external.ImportedBytes = bytes;
+			// Passes are picked by pin formats, e.g. 4:2:2 pins need unpack or pack passes
+			auto& formats = isOutput ? Instance.Resources.OutputFormats : Instance.Resources.InputFormats;
+			if (formats[index] != tex.format)
+				Instance.BuildRenderGraph();
+		});
+}
+
+void SampleEventDelegates::OnConnectionClosed()
+{
+	if (Instance.EventLog)
+		Instance.EventLog->RecordConnectionClosed();
+	Instance.UpdateSyncState(nos::app::ExecutionState::IDLE);
+	LogInfo("Instance ", Instance.Index, ": Connection to Nodos closed");
+	Instance.Tasks.Push([this]()
+		{
+			Instance.ResetState();
+		});
+}
+
+void SampleEventDelegates::OnStateChanged(nos::app::ExecutionState newState)
+{
+	Instance.UpdateSyncState(newState);
+	Instance.Tasks.Push([this, newState]()
+		{
+			Instance.State.ExecutionStateMainThread = newState;
+			if (newState == nos::app::ExecutionState::SYNCED)
+			{
+				// Instances without a client render without semaphores
+				if (!Client)
+					return;
+				flatbuffers::FlatBufferBuilder mb;
+				auto offset = nos::CreateAppEventOffset(mb, nos::app::CreateRequestSyncSemaphores(mb, false));
+				mb.Finish(offset);
+				auto buf = mb.Release();
+				auto root = flatbuffers::GetRoot<nos::app::AppEvent>(buf.data());
+				Client->Send(*root);
+			}
+			else
+			{
+				Instance.DeleteSyncSemaphores();
+			}
+		});
+}
+
+void SampleEventDelegates::OnExecuteStart(nos::app::AppExecuteStart const* appExecuteStart)
+{
+	auto& state = Instance.State;
+	{
+		std::unique_lock<std::mutex> lock(state.ExecutionStateMutex);
+		state.FrameStartTime = std::chrono::steady_clock::now();
+		if (appExecuteStart->reset())
+			state.NodosFrameNumber = std::nullopt;
+		else
+			state.NodosFrameNumber = appExecuteStart->frame_counter();
+		if (state.ResyncPending && state.NodosFrameNumber)
+		{
+			state.ResyncPending = false;
+			state.ResyncFrameNumber = state.NodosFrameNumber;
+		}
+	}
+	state.Wakeup.Signal();
+	NotifyFrameEvent();
+	LogDebug("Instance ", Instance.Index, ": Execution started: ", appExecuteStart->frame_counter());
+}
+
+void SampleEventDelegates::OnSyncSemaphoresFromNodos(nos::app::SyncSemaphoresFromNodos const* syncSemaphoresFromNodos)
+{
+	Instance.Tasks.Push([this, pid = syncSemaphoresFromNodos->pid(), inputSemaphoreHandle = syncSemaphoresFromNodos->input_semaphore(),
+		outputSemaphoreHandle = syncSemaphoresFromNodos->output_semaphore(),
+		renderSubmittedEvent = syncSemaphoresFromNodos->process_render_submitted_event()]()
+		{
+			auto& state = Instance.State;
+			Instance.DeleteSyncSemaphores();
+			// Without a client, frames complete on the CPU instead of through the semaphores
+			if (!Client)
+				return;
+			state.InputSemaphore = ImportSemaphore(Client, pid, inputSemaphoreHandle);
+			state.OutputSemaphore = ImportSemaphore(Client, pid, outputSemaphoreHandle);
+			state.RenderSubmittedEvent = ImportedOSHandle(Client, (NOS_HANDLE)renderSubmittedEvent, "render submitted event");
+		});
+}
+
+AppInstance::AppInstance(uint32_t index, nos::app::IAppServiceClient* client)
+	: Index(index), Client(client), EventDelegates(std::make_unique<SampleEventDelegates>(*this, client)), Resolution(g_Options.FrameBudgetMs),
+	FrameStarts(std::chrono::microseconds(g_Options.SpinWaitMicroseconds))
+{
+	State.ShaderInputs.resize(g_Options.InputCount);
+	State.ShaderOutputs.resize(g_Options.OutputCount);
+	State.BufferInputs.resize(g_Options.BufferCount);
+	// Headless runs never show the window
+	Preview.SetRate(g_Options.Headless ? 0 : g_Options.PreviewRate);
+	// Wake the render thread for new tasks, the event keeps the signal if it arrives before the thread sleeps
+	Tasks.OnPush = [this]()
+		{
+			State.Wakeup.Signal();
+		};
+}
+
+AppInstance::~AppInstance()
+{
+	assert(!Thread.joinable() && "Instance must be stopped before destruction");
+}
+
+bool AppInstance::Start(GLFWwindow* context)
+{
+	if (!context)
+	{
+		LogError("Instance ", Index, ": No GL context to render with");
+		return false;
+	}
+	Context = context;
+	StopRequested = false;
+	Thread = std::thread([this]() { RenderThread(); });
+	return true;
+}
+
+GLFWwindow* AppInstance::Stop()
+{
+	{
+		std::unique_lock lock(State.ExecutionStateMutex);
+		StopRequested = true;
+	}
+	State.Wakeup.Signal();
+	if (Thread.joinable())
+		Thread.join();
+	return std::exchange(Context, nullptr);
+}
+
+void AppInstance::RenderThread()
+{
+	glfwMakeContextCurrent(Context);
+	EnableDebugOutput();
+	InitGL();
+	while (!StopRequested)
+	{
+		size_t taskCount = Tasks.Process();
+		Stats.TasksProcessed += taskCount;
+		// Tasks that delete GL objects invalidate the bindings themselves, but may also rebuild the graph
+		if (taskCount)
+			BindingsKept = false;
+		if (Client && !Client->IsConnected())
+		{
+			LogInfo("Instance ", Index, ": Reconnecting to Nodos...");
+			// Retried every second, Stop wakes it at once
+			while (!StopRequested && (!Client->TryConnect() || !Client->IsConnected()))
+				State.Wakeup.Wait(std::chrono::seconds(1));
+			continue;
+		}
+
+		bool ready = IsReadyToRender();
+		bool render = false;
+		{
+			std::unique_lock lock(State.ExecutionStateMutex);
+			auto waitStart = std::chrono::steady_clock::now();
+			if (!ready || State.ExecutionState == nos::app::ExecutionState::IDLE)
+				LastProgressTime = waitStart;
+			auto wakeUp = [&]()
+				{
+					// The first frame started after a stall sets the pace again, whatever its number
+					if (State.ResyncFrameNumber)
+						State.CurFrameNumber = *std::exchange(State.ResyncFrameNumber, std::nullopt);
+					return StopRequested || Tasks.HasPending() || (ready && IsFrameStartedOrIdleLocked());
+				};
+			auto watchdogTimeout = std::chrono::milliseconds(g_Options.WatchdogTimeoutMs);
+			auto spin = ready && g_Options.SpinWaitMicroseconds ? FrameStarts.GetSpinWindow() : std::nullopt;
+			if (ready && watchdogTimeout.count() == 0)
+			{
+				LogDebug("Instance ", Index, ": Waiting for Nodos to start frame ", State.CurFrameNumber);
+				State.Wakeup.Wait(lock, wakeUp, spin);
+			}
+			else if (ready)
+			{
+				// Bounded, so a frame start that never arrives can't hang the instance
+				while (!State.Wakeup.WaitFor(lock, watchdogTimeout, wakeUp, spin))
+				{
+					auto stalledFor = std::chrono::steady_clock::now() - LastProgressTime;
+					if (State.ExecutionState != nos::app::ExecutionState::IDLE && stalledFor >= watchdogTimeout)
+						RecoverFromStallLocked(stalledFor);
+				}
+			}
+			else
+			{
+				// Not synced yet. Readiness only changes through tasks, and losing the connection pushes one, so nothing to poll.
+				State.Wakeup.Wait(lock, wakeUp);
+			}
+			auto waitEnd = std::chrono::steady_clock::now();
+			Stats.ExecutionWaitNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(waitEnd - waitStart).count();
+			if (State.FrameStartTime != SeenFrameStartTime)
+			{
+				SeenFrameStartTime = State.FrameStartTime;
+				FrameStarts.OnFrameStart(SeenFrameStartTime);
+				Stats.FrameStartLatencyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(waitEnd - SeenFrameStartTime).count();
+				Stats.FrameStartsSeen++;
+			}
+			render = ready && !StopRequested && IsFrameStartedOrIdleLocked() && State.ExecutionState != nos::app::ExecutionState::IDLE;
+			if (render)
+				SkipLateFramesLocked();
+			Stats.NodosFrameNumber = State.NodosFrameNumber.value_or(0);
+			Stats.ExecutionState = uint64_t(State.ExecutionState);
+		}
+		auto bindsBefore = GetGLState().GetIssuedBinds();
+		auto compileCount = Graph.GetCompileCount();
+		if (render && RenderFrame())
+		{
+			CheckSteadyStateBinds(bindsBefore, compileCount);
+			// Compiling rebinds textures and resizing trims the pool, which invalidates the bindings
+			BindingsKept = Graph.GetCompileCount() == compileCount;
+			auto preview = PublishPreview();
+			PreviewBound = preview != PublishResult::Skipped;
+			if (preview == PublishResult::Resized)
+				BindingsKept = false;
+			auto& state = GetGLState();
+			StateChangesIssued = state.GetIssuedCount();
+			StateChangesElided = state.GetElidedCount();
+			RenderedFrames++;
+			Stats.RenderedFrames++;
+			LastProgressTime = std::chrono::steady_clock::now();
+			Stalled = false;
+			NotifyFrameEvent();
+		}
+		else if (render)
+		{
+			Stats.FailedFrames++;
+			BindingsKept = false;
+		}
+		Stats.CurFrameNumber = State.CurFrameNumber;
+		Stats.TaskQueueDepth = Tasks.GetDepth();
+		Stats.ImportedBytes = GetImportedBytes();
+		Stats.PooledBytes = Graph.GetPool().GetByteCount();
+		auto now = std::chrono::steady_clock::now();
+		if (g_Options.MemoryReportSeconds && now - LastMemoryReport >= std::chrono::seconds(g_Options.MemoryReportSeconds))
+		{
+			if (LastMemoryReport != std::chrono::steady_clock::time_point{})
+				LogMemoryUsage();
+			LastMemoryReport = now;
+		}
+		PublishStats(Index, Stats);
+	}
+	ShutdownGL();
+	glfwMakeContextCurrent(nullptr);
+}
+
+void AppInstance::SkipLateFramesLocked()
+{
+	if (!State.NodosFrameNumber || *State.NodosFrameNumber <= State.CurFrameNumber)
+		return;
+	uint64_t lag = *State.NodosFrameNumber - State.CurFrameNumber;
+	uint64_t maxLag = g_Options.LateFrames == LateFramePolicy::RenderAll ? lag
+		: g_Options.LateFrames == LateFramePolicy::MaxLag ? g_Options.MaxFrameLag : 0;
+	if (lag <= maxLag)
+		return;
+	// The completion sent for the frame rendered instead tells Nodos where the instance is
+	uint64_t skipped = lag - maxLag;
+	State.CurFrameNumber += skipped;
+	Stats.SkippedFrames += skipped;
+	SkippedFrames += skipped;
+	LogDebug("Instance ", Index, ": Skipped ", skipped, " late frame(s), rendering ", State.CurFrameNumber, " of ", *State.NodosFrameNumber);
+}
+
+void AppInstance::RecoverFromStallLocked(std::chrono::steady_clock::duration stalledFor)
+{
+	if (!Stalled)
+	{
+		Stalled = true;
+		Stats.Stalls++;
+		LogWarning("Instance ", Index, ": No frame started for ", std::chrono::duration_cast<std::chrono::milliseconds>(stalledFor).count(),
+			" ms (state ", uint32_t(State.ExecutionState), ", next frame ", State.CurFrameNumber, ", last started ",
+			State.NodosFrameNumber ? std::to_string(*State.NodosFrameNumber) : "none", ", tasks pending ", Tasks.HasPending() ? "yes" : "no",
+			"), resynchronizing with Nodos");
+	}
+	// Nodos may be blocked on a frame it thinks is still rendering
+	if (State.RenderSubmittedEvent && State.RenderSubmittedEvent->OSHandle)
+		SignalOSEvent(*State.RenderSubmittedEvent->OSHandle);
+	// A start Nodos sent for a frame behind ours is one it still waits for, e.g. after its counter went back without a reset
+	if (State.NodosFrameNumber && *State.NodosFrameNumber + 1 < State.CurFrameNumber)
+		State.CurFrameNumber = *State.NodosFrameNumber;
+	else
+		State.ResyncPending = true;
+}
+
+PublishResult AppInstance::PublishPreview()
+{
+	auto& output = State.ShaderOutputs[0];
+	// Packed and integer outputs can't be filtered into a preview
+	auto& format = GetFormatInfo(output.Texture.format);
+	if (format.Packing != PixelPacking::None || format.IsInteger())
+		return PublishResult::Skipped;
+	return Preview.Publish(output.Image.Image, output.Texture.width, output.Texture.height);
+}
+
+void AppInstance::CheckSteadyStateBinds(GLBindCounts const& before, uint64_t compileCount)
+{
+	if (!BindingsKept || Graph.GetCompileCount() != compileCount)
+		return;
+	auto& issued = GetGLState().GetIssuedBinds();
+	auto expected = Graph.GetSteadyStateBinds();
+	// The graph's first pass takes the program back from the preview
+	if (PreviewBound)
+		expected.Program++;
+	auto excess = [](uint64_t issued, uint64_t expected) { return issued > expected ? issued - expected : 0; };
+	uint64_t redundant = excess(issued.Framebuffer - before.Framebuffer, expected.Framebuffer)
+		+ excess(issued.Program - before.Program, expected.Program)
+		+ excess(issued.VertexArray - before.VertexArray, expected.VertexArray);
+	if (redundant && RedundantBinds.fetch_add(redundant) == 0)
+		LogWarning("Instance ", Index, ": A steady-state frame issued ", redundant, " framebuffer, program or vertex array bind(s) more than the render graph needs");
+}
+
+void AppInstance::InitGL()
+{
+	glCreateVertexArrays(1, &VAO);
+	GLuint vaoBindingPoint = 0;
+	glVertexArrayVertexBuffer(VAO, vaoBindingPoint, glData.VBO,
+		0,                  // offset of the first element in the buffer
+		5 * sizeof(float));   // stride == 3 position floats + 2 texture coordinate floats
+
+	GLuint attribPos = 0;
+	GLuint attribTexCoord = 1;
+	glEnableVertexArrayAttrib(VAO, attribPos);
+	glEnableVertexArrayAttrib(VAO, attribTexCoord);
+
+	glVertexArrayAttribFormat(VAO, attribPos, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribFormat(VAO, attribTexCoord, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+
+	glVertexArrayAttribBinding(VAO, attribPos, vaoBindingPoint);
+	glVertexArrayAttribBinding(VAO, attribTexCoord, vaoBindingPoint);
+
+	BuildRenderGraph();
+	if (Golden)
+	{
+		// Every frame has to be compared, so wait for the comparison instead of dropping frames
+		Recorder = FrameRecorder::Create("Instance " + std::to_string(Index) + " golden comparison",
+			[golden = Golden.get()](const uint8_t* rgba, uint32_t width, uint32_t height, uint64_t frameNumber) { return golden->Compare(rgba, width, height, frameNumber); },
+			false);
+	}
+	else if (!g_Options.RecordPath.empty())
+		Recorder = FrameRecorder::Open(GetRecordingPath(g_Options.RecordPath, Index), g_Options.RecordFps);
+}
+
+void AppInstance::ShutdownGL()
+{
+	if (Recorder)
+		Recorder->Close();
+	Recorder.reset();
+	if (Source)
+		Source->Close();
+	Preview.ReleaseRenderResources();
+	ResetState();
+	FrameTimer.Release();
+	SemaphoreTimer.Release();
+	Graph.Clear();
+	Graph.GetPool().Clear();
+	if (VAO)
+		glDeleteVertexArrays(1, &VAO);
+	VAO = 0;
+}
+
+void AppInstance::CreateLocalTextures(uint32_t width, uint32_t height)
+{
+	for (auto* externals : { &State.ShaderInputs, &State.ShaderOutputs })
+	{
+		for (auto& external : *externals)
+		{
+			GLuint texture = 0;
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+			TrackResource(TrackedKind::Texture, texture, "local pin texture");
+			external.Image = GLImportedTexture(ImportedOSHandle(), texture, 0);
+			external.ImportedBytes = uint64_t(width) * height * 4;
+			external.Texture = {};
+			external.Texture.width = width;
+			external.Texture.height = height;
+			external.Texture.format = nos::sys::vulkan::Format::R8G8B8A8_UNORM;
+		}
+	}
+	for (auto& external : State.BufferInputs)
+	{
+		external.Description = {};
+		external.Description.size_in_bytes = 4096;
+		if (auto standIn = CreateStandInBuffer(external.Description))
+		{
+			external.ImportedBytes = standIn->Size;
+			external.Buffer = std::move(*standIn);
+		}
+	}
+	// The previous textures and buffers are deleted
+	GetGLState().InvalidateBindings();
+}
+
+void AppInstance::UpdateBufferPin(uint32_t index, uint8_t const* value)
+{
+	auto bufRoot = flatbuffers::GetRoot<nos::sys::vulkan::Buffer>(value);
+	if (!bufRoot)
+	{
+		LogError("Failed to unpack buffer");
+		return;
+	}
+	nos::sys::vulkan::TBuffer buf{};
+	bufRoot->UnPackTo(&buf);
+	auto& external = State.BufferInputs[index];
+	uint64_t bytes = buf.external_memory.allocation_size();
+	if (!ReserveMemory(bytes, external.ImportedBytes))
+	{
+		Stats.ImportFailures++;
+		// Nodos no longer uses the previous buffer, stop rendering until a value that fits arrives
+		external.Buffer = {};
+		external.ImportedBytes = 0;
+		GetGLState().InvalidateBindings();
+		return;
+	}
+	// Replayed events carry handles from another process, stand in for them with local buffers
+	auto imported = Client ? ImportBuffer(Client, buf) : CreateStandInBuffer(buf);
+	if (!imported)
+	{
+		LogError("Failed to import buffer");
+		Stats.ImportFailures++;
+		return;
+	}
+	Stats.BuffersImported++;
+	external.Description = buf;
+	external.Buffer = std::move(*imported);
+	GetGLState().InvalidateBindings();
+	external.ImportedBytes = bytes;
+}
+
+uint64_t AppInstance::GetImportedBytes() const
+{
+	uint64_t bytes = 0;
+	for (auto* externals : { &State.ShaderInputs, &State.ShaderOutputs })
+		for (auto& external : *externals)
+			bytes += external.ImportedBytes;
+	for (auto& external : State.BufferInputs)
+		bytes += external.ImportedBytes;
+	return bytes;
+}
+
+bool AppInstance::ReserveMemory(uint64_t bytes, uint64_t released)
+{
+	if (g_Options.MemoryBudgetMB == 0)
+		return true;
+	uint64_t budget = uint64_t(g_Options.MemoryBudgetMB) << 20;
+	// The pin keeps its previous allocation until the import replaces it, but only one of them counts afterwards
+	auto projected = [&]() { return GetImportedBytes() - released + bytes + Graph.GetPool().GetByteCount(); };
+	if (projected() <= budget)
+		return true;
+	// Render targets the graph holds are needed for the next frame, only the unused ones can go
+	uint64_t pooled = Graph.GetPool().GetByteCount();
+	Graph.GetPool().Trim();
+	if (Graph.GetPool().GetByteCount() != pooled)
+	{
+		Stats.MemoryEvictions++;
+		LogInfo("Instance ", Index, ": Evicted ", (pooled - Graph.GetPool().GetByteCount()) >> 20, " MB of pooled textures to stay within the memory budget");
+	}
+	if (projected() <= budget)
+		return true;
+	Stats.BudgetRejections++;
+	LogError("Instance ", Index, ": Importing ", bytes >> 20, " MB would hold ", projected() >> 20, " MB, over the memory budget of ", g_Options.MemoryBudgetMB, " MB");
+	return false;
+}
+
+void AppInstance::LogMemoryUsage()
+{
+	// One line per instance, so the rate limit doesn't cut reports of many pins short
+	std::string pins;
+	auto addPin = [&](std::string const& name, uint64_t bytes) {
+		pins += (pins.empty() ? "" : ", ") + name + " " + std::to_string(bytes >> 10) + " KB";
+	};
+	for (uint32_t i = 0; i < State.ShaderInputs.size(); ++i)
+		addPin(GetTexturePinName(false, i), State.ShaderInputs[i].ImportedBytes);
+	for (uint32_t i = 0; i < State.ShaderOutputs.size(); ++i)
+		addPin(GetTexturePinName(true, i), State.ShaderOutputs[i].ImportedBytes);
+	for (uint32_t i = 0; i < State.BufferInputs.size(); ++i)
+		addPin(GetBufferPinName(i), State.BufferInputs[i].ImportedBytes);
+	uint64_t imported = GetImportedBytes();
+	uint64_t pooled = Graph.GetPool().GetByteCount();
+	std::string budget = g_Options.MemoryBudgetMB ? " of " + std::to_string(g_Options.MemoryBudgetMB) + " MB budget" : "";
+	LogInfo("Instance ", Index, ": ", (imported + pooled) >> 20, " MB", budget, ", ", imported >> 20, " MB imported (", pins, "), ", pooled >> 20, " MB pooled");
+}
+
+void AppInstance::BuildRenderGraph()
+{
+	Graph.Clear();
+	Resources = {};
+	for (uint32_t i = 0; i < g_Options.InputCount; ++i)
+		Resources.ShaderInputs.push_back(Graph.AddExternal(GetTexturePinName(false, i)));
+	for (uint32_t i = 0; i < g_Options.OutputCount; ++i)
+		Resources.ShaderOutputs.push_back(Graph.AddExternal(GetTexturePinName(true, i)));
+	for (auto& input : State.ShaderInputs)
+		Resources.InputFormats.push_back(input.Texture.format);
+	for (auto& output : State.ShaderOutputs)
+		Resources.OutputFormats.push_back(output.Texture.format);
+	auto& transientFormat = GetFormatInfo(nos::sys::vulkan::Format::R16G16B16A16_SFLOAT);
+
+	// 4:2:2 inputs are unpacked to full width first
+	std::vector<ResourceId> sampleInputs;
+	std::vector<SampledInput> sampleInputDescs;
+	for (size_t i = 0; i < Resources.ShaderInputs.size(); ++i)
+	{
+		auto input = Resources.ShaderInputs[i];
+		auto& format = GetFormatInfo(Resources.InputFormats[i]);
+		if (format.Packing == PixelPacking::None)
+		{
+			sampleInputs.push_back(input);
+			sampleInputDescs.push_back({ format, GetPinShape(false, uint32_t(i)).Target });
+			continue;
+		}
+		auto unpacked = Graph.AddTransient(GetTexturePinName(false, uint32_t(i)) + " Unpacked", GL_RGBA16F, input, 2.0f, 1.0f);
+		Graph.AddPass(RenderPass{
+			.Name = "Unpack",
+			.Program = GetUnpackProgram(format.Packing),
+			.Compute = true,
+			.Inputs = { input },
+			.Outputs = { unpacked },
+		});
+		sampleInputs.push_back(unpacked);
+		sampleInputDescs.push_back({ transientFormat });
+	}
+
+	// The sample triangle comes first and writes every output at once, effects are then chained on each of its results.
+	// 4:2:2 outputs are packed by a compute pass that also runs the last effect.
+	// With --frame-budget the sample and every effect render at the dynamic scale, then a copy or the pack upsamples.
+	bool hasEffects = !g_Options.Effects.empty();
+	bool isDynamic = g_Options.FrameBudgetMs > 0;
+	std::vector<ResourceId> sampleTargets;
+	std::vector<FormatInfo> sampleTargetFormats;
+	for (size_t o = 0; o < Resources.ShaderOutputs.size(); ++o)
+	{
+		auto output = Resources.ShaderOutputs[o];
+		auto& format = GetFormatInfo(Resources.OutputFormats[o]);
+		bool isPacked = format.Packing != PixelPacking::None;
+		bool isDirect = !hasEffects && !isPacked && !isDynamic;
+		float scaleX = isPacked ? 2.0f : 1.0f;
+		sampleTargets.push_back(isDirect ? output
+			: isDynamic ? Graph.AddDynamicTransient("Sample Output", GL_RGBA16F, output, scaleX, 1.0f)
+			: Graph.AddTransient("Sample Output", GL_RGBA16F, output, scaleX, 1.0f));
+		sampleTargetFormats.push_back(isDirect ? format : transientFormat);
+	}
+	Graph.AddPass(RenderPass{
+		.Name = "Sample",
+		.Program = GetSampleProgram(sampleInputDescs, sampleTargetFormats),
+		.VAO = VAO,
+		.ClearOutputs = sampleTargets != Resources.ShaderOutputs,
+		.Inputs = sampleInputs,
+		.Outputs = sampleTargets,
+	});
+	for (size_t o = 0; o < Resources.ShaderOutputs.size(); ++o)
+	{
+		auto current = sampleTargets[o];
+		auto& format = GetFormatInfo(Resources.OutputFormats[o]);
+		auto packing = format.Packing;
+		// A fused effect would run at the output resolution
+		bool fuseLast = packing != PixelPacking::None && hasEffects && !isDynamic;
+		size_t unfusedCount = g_Options.Effects.size() - (fuseLast ? 1 : 0);
+		for (size_t i = 0; i < unfusedCount; ++i)
+		{
+			auto& effect = g_Options.Effects[i];
+			bool isLast = i + 1 == g_Options.Effects.size() && !isDynamic;
+			auto target = isLast ? Resources.ShaderOutputs[o] : Graph.AddTransient(effect + " Output", GL_RGBA16F, sampleTargets[o]);
+			Graph.AddPass(RenderPass{
+				.Name = effect,
+				.Program = GetEffectProgram(effect, isLast ? format : transientFormat),
+				.Inputs = { current },
+				.Outputs = { target },
+			});
+			current = target;
+		}
+		// A fragment pass like the effects, --check-orientation covers it
+		if (isDynamic && packing == PixelPacking::None)
+			Graph.AddPass(RenderPass{
+				.Name = "Upsample",
+				.Program = GetEffectProgram("copy", format),
+				.Inputs = { current },
+				.Outputs = { Resources.ShaderOutputs[o] },
+			});
+		if (packing == PixelPacking::None)
+			continue;
+		std::string fusedEffect = fuseLast ? g_Options.Effects.back() : "";
+		Graph.AddPass(RenderPass{
+			.Name = "Pack" + (fusedEffect.empty() ? "" : " + " + fusedEffect),
+			.Program = GetPackProgram(packing, fusedEffect),
+			.Compute = true,
+			.Inputs = { current },
+			.Outputs = { Resources.ShaderOutputs[o] },
+		});
+	}
+}
+
+void AppInstance::CreateTexturePinsInNodos(const nos::fb::Node& appNode)
+{
+	LogInfo("Instance ", Index, ": Creating pins");
+	nos::fb::UUID nodeId = *appNode.id();
+	bool createPins = !appNode.pins() || appNode.pins()->size() == 0;
+	std::vector<flatbuffers::Offset<nos::fb::Pin>> pins;
+	flatbuffers::FlatBufferBuilder fbb;
+	// Pin of each slot, slots without one keep the pin they had
+	std::vector<std::optional<nos::fb::UUID>> inputIds(g_Options.InputCount), outputIds(g_Options.OutputCount), bufferIds(g_Options.BufferCount);
+	if (createPins)
+	{
+		for (uint32_t i = 0; i < g_Options.InputCount; ++i)
+		{
+			auto& id = inputIds[i].emplace(GenerateRandomUUID());
+			pins.push_back(nos::fb::CreatePinDirect(fbb, &id, GetTexturePinName(false, i).c_str(), nos::sys::vulkan::Texture::GetFullyQualifiedName(), nos::fb::ShowAs::INPUT_PIN, nos::fb::CanShowAs::INPUT_PIN_ONLY, "Shader Vars", 0, 0, 0, 0, 0, 0, 0, false, false, false, 0, 0, nos::fb::PinContents::JobPin, 0, 0, nos::fb::PinValueDisconnectBehavior::KEEP_LAST_VALUE, "Example tooltip", "Texture Input"));
+		}
+		for (uint32_t i = 0; i < g_Options.OutputCount; ++i)
+		{
+			auto& id = outputIds[i].emplace(GenerateRandomUUID());
+			pins.push_back(nos::fb::CreatePinDirect(fbb, &id, GetTexturePinName(true, i).c_str(), nos::sys::vulkan::Texture::GetFullyQualifiedName(), nos::fb::ShowAs::OUTPUT_PIN, nos::fb::CanShowAs::OUTPUT_PIN_ONLY, "Shader Vars", 0, 0, 0, 0, 0, 0, 0, false, false, false, 0, 0, nos::fb::PinContents::JobPin, 0, 0, nos::fb::PinValueDisconnectBehavior::KEEP_LAST_VALUE, "Example tooltip", "Texture Output"));
+		}
+		for (uint32_t i = 0; i < g_Options.BufferCount; ++i)
+		{
+			auto& id = bufferIds[i].emplace(GenerateRandomUUID());
+			pins.push_back(nos::fb::CreatePinDirect(fbb, &id, GetBufferPinName(i).c_str(), nos::sys::vulkan::Buffer::GetFullyQualifiedName(), nos::fb::ShowAs::INPUT_PIN, nos::fb::CanShowAs::INPUT_PIN_ONLY, "Shader Vars", 0, 0, 0, 0, 0, 0, 0, false, false, false, 0, 0, nos::fb::PinContents::JobPin, 0, 0, nos::fb::PinValueDisconnectBehavior::KEEP_LAST_VALUE, "Example tooltip", "Buffer Input"));
+		}
+	}
+	else
+	{
+		// Match existing pins by name, pins without a known name fill the remaining slots of their type in order
+		uint32_t nextInput = 0, nextOutput = 0, nextBuffer = 0;
+		for (auto pin : *appNode.pins())
+		{
+			bool isOutput = pin->show_as() == nos::fb::ShowAs::OUTPUT_PIN;
+			if (!isOutput && pin->show_as() != nos::fb::ShowAs::INPUT_PIN)
+				continue;
+			bool isBuffer = !isOutput && pin->type_name() && pin->type_name()->str() == nos::sys::vulkan::Buffer::GetFullyQualifiedName();
+			uint32_t count = isBuffer ? g_Options.BufferCount : isOutput ? g_Options.OutputCount : g_Options.InputCount;
+			uint32_t& next = isBuffer ? nextBuffer : isOutput ? nextOutput : nextInput;
+			std::optional<uint32_t> slot;
+			for (uint32_t i = 0; i < count && pin->name() && !slot; ++i)
+				if (pin->name()->str() == (isBuffer ? GetBufferPinName(i) : GetTexturePinName(isOutput, i)))
+					slot = i;
+			if (!slot && next < count)
+				slot = next++;
+			if (!slot)
+				continue;
+			(isBuffer ? bufferIds : isOutput ? outputIds : inputIds)[*slot] = *pin->id();
+		}
+	}
+	// Slots are looked up by pin value tasks, which only see them in this state. Values of the new pins arrive after this.
+	Tasks.Push([this, nodeId, inputIds = std::move(inputIds), outputIds = std::move(outputIds), bufferIds = std::move(bufferIds)]()
+		{
+			EventDelegates->NodeId = nodeId;
+			auto assign = [](auto& externals, std::vector<std::optional<nos::fb::UUID>> const& ids)
+				{
+					for (size_t i = 0; i < ids.size(); ++i)
+						if (ids[i])
+							externals[i].Id = *ids[i];
+				};
+			assign(State.ShaderInputs, inputIds);
+			assign(State.ShaderOutputs, outputIds);
+			assign(State.BufferInputs, bufferIds);
+			State.PinSlots.clear();
+			for (uint32_t i = 0; i < g_Options.InputCount; ++i)
+				State.PinSlots[State.ShaderInputs[i].Id] = PinSlot{ .IsOutput = false, .Index = i };
+			for (uint32_t i = 0; i < g_Options.OutputCount; ++i)
+				State.PinSlots[State.ShaderOutputs[i].Id] = PinSlot{ .IsOutput = true, .Index = i };
+			for (uint32_t i = 0; i < g_Options.BufferCount; ++i)
+				State.PinSlots[State.BufferInputs[i].Id] = PinSlot{ .IsBuffer = true, .Index = i };
+		});
+
+	auto offset = nos::CreatePartialNodeUpdateDirect(fbb, &nodeId, nos::ClearFlags::NONE, 0, &pins, 0, 0, 0, 0);
+	fbb.Finish(offset);
+	auto buf = fbb.Release();
+	auto root = flatbuffers::GetRoot<nos::PartialNodeUpdate>(buf.data());
+	if (Client)
+		Client->SendPartialNodeUpdate(*root);
+}
+
+void AppInstance::UpdateSyncState(nos::app::ExecutionState newState)
+{
+	{
+		std::unique_lock<std::mutex> lock(State.ExecutionStateMutex);
+		State.ExecutionState = newState;
+	}
+	State.Wakeup.Signal();
+	NotifyFrameEvent();
+}
+
+void AppInstance::DeleteSyncSemaphores()
+{
+	State.InputSemaphore = std::nullopt;
+	State.OutputSemaphore = std::nullopt;
+	if (State.RenderSubmittedEvent)
+	{
+		if(State.RenderSubmittedEvent->OSHandle)
+			SignalOSEvent(*State.RenderSubmittedEvent->OSHandle);
+		State.RenderSubmittedEvent = std::nullopt;
+	}
+	State.CurFrameNumber = 0;
+}
+
+void AppInstance::ResetState()
+{
+	DeleteSyncSemaphores();
+	FrameStarts.Reset();
+	// Releases the pins' GL objects and handles
+	for (auto& external : State.ShaderInputs)
+		external = {};
+	for (auto& external : State.ShaderOutputs)
+		external = {};
+	for (auto& external : State.BufferInputs)
+		external = {};
+	GetGLState().InvalidateBindings();
+	State.PinSlots.clear();
+	State.CurFrameNumber = 0;
+	std::unique_lock lock(State.ExecutionStateMutex);
+	State.NodosFrameNumber = std::nullopt;
+	State.ExecutionState = nos::app::ExecutionState::IDLE;
+	State.ExecutionStateMainThread = nos::app::ExecutionState::IDLE;
+	lock.unlock();
+	LogLiveResources(LogSeverity::Debug);
+}
+
+bool AppInstance::IsReadyToRender()
+{
+	auto hasImage = [](ExternalTexture const& external) { return external.Image.Image != 0; };
+	bool areTexturesReady = !State.ShaderInputs.empty() && !State.ShaderOutputs.empty() && std::ranges::all_of(State.ShaderInputs, hasImage) && std::ranges::all_of(State.ShaderOutputs, hasImage);
+	bool areBuffersReady = std::ranges::all_of(State.BufferInputs, [](ExternalBuffer const& external) { return external.Buffer.Buffer != 0; });
+	// Instances without a client have nothing to synchronize with
+	bool areSemaphoresReady = !Client || (State.InputSemaphore && State.OutputSemaphore && State.RenderSubmittedEvent);
+	return State.ExecutionStateMainThread == nos::app::ExecutionState::SYNCED && areTexturesReady && areBuffersReady && areSemaphoresReady;
+}
+
+bool AppInstance::IsFrameStartedOrIdle()
+{
+	std::unique_lock<std::mutex> lock(State.ExecutionStateMutex);
+	return IsFrameStartedOrIdleLocked();
+}
+
+bool AppInstance::IsFrameStartedOrIdleLocked() const
+{
+	return (State.NodosFrameNumber && *State.NodosFrameNumber >= State.CurFrameNumber) || State.ExecutionState == nos::app::ExecutionState::IDLE;
+}
+
+bool AppInstance::IsIdle()
+{
+	std::unique_lock<std::mutex> lock(State.ExecutionStateMutex);
+	return State.ExecutionState == nos::app::ExecutionState::IDLE;
+}
+
+bool AppInstance::RenderFrame()
+{
+	auto& inputs = State.ShaderInputs;
+	auto& outputs = State.ShaderOutputs;
+	if (Source)
+	{
+		std::vector<GLuint> images;
+		for (auto& input : inputs)
+			images.push_back(input.Image.Image);
+		Source->Upload(images);
+	}
+	//wait for input semaphore
+	if (State.InputSemaphore)
+	{
+		std::vector<GLuint> images;
+		for (auto& input : inputs)
+			images.push_back(input.Image.Image);
+		std::vector<GLenum> srcLayouts(images.size(), GL_LAYOUT_TRANSFER_DST_EXT);
+		// Buffers written by Vulkan nodes are acquired together with the textures
+		std::vector<GLuint> buffers;
+		for (auto& buffer : State.BufferInputs)
+			buffers.push_back(buffer.Buffer.Buffer);
+		LogDebug("Instance ", Index, ": Waiting for input semaphore");
+		// The wait happens on the GPU, queuing it returns at once. Results arrive a few frames late.
+		Stats.SemaphoreWaitNanoseconds += SemaphoreTimer.CollectTotal();
+		SemaphoreTimer.Begin();
+		glWaitSemaphoreEXT(State.InputSemaphore->Semaphore, GLuint(buffers.size()), buffers.data(), GLuint(images.size()), images.data(), srcLayouts.data());
+		SemaphoreTimer.End();
+		glFlush();
+		if (glGetError() != GL_NO_ERROR)
+		{
+			LogError("Failed to wait for input semaphore");
+			return false;
+		}
+	}
+	//render to texture
+	// Nothing else renders on this context, so the origin stays upper left after the first frame
+	GetGLState().ClipControl(GL_UPPER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+	for (size_t i = 0; i < inputs.size(); ++i)
+		Graph.SetExternal(Resources.ShaderInputs[i], inputs[i].Image.Image, GetStorageWidth(inputs[i].Texture), inputs[i].Texture.height);
+	for (size_t i = 0; i < outputs.size(); ++i)
+		Graph.SetExternal(Resources.ShaderOutputs[i], outputs[i].Image.Image, GetStorageWidth(outputs[i].Texture), outputs[i].Texture.height, GetFormatInfo(outputs[i].Texture.format).InternalFormat);
+	std::vector<GLuint> storageBuffers;
+	for (auto& buffer : State.BufferInputs)
+		storageBuffers.push_back(buffer.Buffer.Buffer);
+	Graph.SetStorageBuffers(std::move(storageBuffers));
+	bool isDynamic = g_Options.FrameBudgetMs > 0;
+	bool resized = false;
+	if (isDynamic)
+	{
+		if (auto elapsed = FrameTimer.Collect())
+		{
+			Stats.GpuFrameMicroseconds = *elapsed / 1000;
+			float scale = Resolution.Update(double(*elapsed) / 1e6);
+			if (scale != Graph.GetDynamicScale())
+			{
+				LogInfo("Instance ", Index, ": GPU frame time ", Resolution.GetAverage(), " ms against a budget of ", g_Options.FrameBudgetMs, " ms, rendering effects at ", int(scale * 100), "%");
+				Graph.SetDynamicScale(scale);
+				Stats.ResolutionScalePercent = uint64_t(std::lround(scale * 100));
+				resized = true;
+			}
+		}
+		FrameTimer.Begin();
+	}
+	Graph.Execute();
+	if (isDynamic)
+		FrameTimer.End();
+	// Steps are few but far apart, so textures of the previous scale are not worth keeping
+	if (resized)
+		Graph.GetPool().Trim();
+	// Read back before Nodos gets the output, the copy is queued behind the render
+	if (Recorder)
+	{
+		// Readback ignores the texture swizzle, reorder the channels while packing instead
+		auto& format = GetFormatInfo(outputs[0].Texture.format);
+		GLenum readFormat = format.IsInteger() ? (format.HasSwizzle() ? GL_BGRA_INTEGER : GL_RGBA_INTEGER) : (format.HasSwizzle() ? GL_BGRA : GL_RGBA);
+		Recorder->Capture(outputs[0].Image.Image, GetStorageWidth(outputs[0].Texture), outputs[0].Texture.height, State.CurFrameNumber, readFormat);
+	}
+	//signal output semaphore
+	if (State.OutputSemaphore)
+	{
+		std::vector<GLuint> images;
+		for (auto& output : outputs)
+			images.push_back(output.Image.Image);
+		std::vector<GLenum> dstLayouts(images.size(), GL_LAYOUT_TRANSFER_SRC_EXT);
+		glSignalSemaphoreEXT(State.OutputSemaphore->Semaphore, 0, nullptr, GLuint(images.size()), images.data(), dstLayouts.data());
+		glFlush();
+		SignalOSEvent(*State.RenderSubmittedEvent);
+	}
+
+	if (Client)
+	{
+		flatbuffers::FlatBufferBuilder fbb;
+		Client->Send(nos::CreateAppEvent(fbb, nos::app::CreateExecutionCompletedDirect(fbb, &EventDelegates->NodeId, State.CurFrameNumber)));
+	}
+	else
+	{
+		// Stands in for Nodos waiting on the output semaphore before starting the next frame
+		auto waitStart = std::chrono::steady_clock::now();
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+		Stats.SemaphoreWaitNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count();
+	}
+	State.CurFrameNumber++;
+	return true;
+}
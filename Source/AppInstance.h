@@ -0,0 +1,293 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+#include "Import.h"
+#include "RenderGraph.h"
+#include "Recorder.h"
+#include "FileSource.h"
+#include "Golden.h"
+#include "EventLog.h"
+#include "Preview.h"
+#include "Stats.h"
+#include "DynamicResolution.h"
+#include "WakeEvent.h"
+
+struct GLFWwindow;
+
+struct TaskQueue
+{
+	void Push(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Tasks.push(task);
+			Pending++;
+		}
+		if (OnPush)
+			OnPush();
+	}
+	bool HasPending() const
+	{
+		return Pending != 0;
+	}
+	// Tasks pushed and not yet run, from any thread
+	size_t GetDepth() const
+	{
+		return Pending;
+	}
+	// Returns the number of tasks run
+	size_t Process()
+	{
+		std::queue<std::move_only_function<void()>> tasks;
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			tasks = std::move(Tasks);
+		}
+		size_t count = tasks.size();
+		while (!tasks.empty())
+		{
+			auto& task = tasks.front();
+			task();
+			tasks.pop();
+			Pending--;
+		}
+		return count;
+	}
+	// Called after every push, without the queue lock held
+	std::function<void()> OnPush;
+private:
+	std::queue<std::move_only_function<void()>> Tasks;
+	std::mutex Mutex;
+	std::atomic<size_t> Pending = 0;
+};
+
+struct ExternalTexture
+{
+	GLImportedTexture Image;
+	// Size of the whole Vulkan allocation mapped for the pin
+	uint64_t ImportedBytes = 0;
+	nos::fb::UUID Id;
+	nos::sys::vulkan::TTexture Texture;
+};
+
+struct ExternalBuffer
+{
+	GLImportedBuffer Buffer;
+	uint64_t ImportedBytes = 0;
+	nos::fb::UUID Id;
+	nos::sys::vulkan::TBuffer Description;
+};
+
+struct UUIDHash
+{
+	size_t operator()(nos::fb::UUID const& id) const
+	{
+		uint64_t parts[2];
+		static_assert(sizeof(parts) == sizeof(nos::fb::UUID));
+		memcpy(parts, &id, sizeof(parts));
+		return std::hash<uint64_t>{}(parts[0] ^ (parts[1] * 0x9E3779B97F4A7C15ull));
+	}
+};
+
+struct PinSlot
+{
+	bool IsOutput = false;
+	// Buffer pins are always inputs
+	bool IsBuffer = false;
+	uint32_t Index = 0;
+};
+
+struct NodosState
+{
+	std::optional<GLImportedSemaphore> InputSemaphore = {std::nullopt}, OutputSemaphore = {std::nullopt};
+	std::optional<ImportedOSHandle> RenderSubmittedEvent = std::nullopt;
+	// Texture pins, sized from the --inputs/--outputs options
+	std::vector<ExternalTexture> ShaderInputs, ShaderOutputs;
+	// Buffer pins, sized from the --buffers option
+	std::vector<ExternalBuffer> BufferInputs;
+	std::unordered_map<nos::fb::UUID, PinSlot, UUIDHash> PinSlots;
+	nos::app::ExecutionState ExecutionState = nos::app::ExecutionState::IDLE;
+	nos::app::ExecutionState ExecutionStateMainThread = nos::app::ExecutionState::IDLE;
+	std::optional<uint64_t> NodosFrameNumber = std::nullopt;
+	// When the last frame start arrived
+	std::chrono::steady_clock::time_point FrameStartTime;
+	// Set by the watchdog after a stall, the next frame start then resets CurFrameNumber through ResyncFrameNumber
+	bool ResyncPending = false;
+	std::optional<uint64_t> ResyncFrameNumber = std::nullopt;
+	// Protects execution state, frame numbers and resync state
+	std::mutex ExecutionStateMutex;
+	// Wakes the render thread after changes to the execution state, frame starts, task pushes and stop requests
+	WakeEvent Wakeup;
+
+	std::uint64_t CurFrameNumber = 0;
+};
+
+// GL objects shared by every instance
+struct GLData
+{
+	GLuint VBO;
+};
+extern GLData glData;
+
+struct GraphResources
+{
+	std::vector<ResourceId> ShaderInputs;
+	std::vector<ResourceId> ShaderOutputs;
+	// Format of each pin's texture when the graph was built, the graph is rebuilt when it changes
+	std::vector<nos::sys::vulkan::Format> InputFormats;
+	std::vector<nos::sys::vulkan::Format> OutputFormats;
+};
+
+struct AppInstance;
+
+struct SampleEventDelegates : nos::app::IEventDelegates
+{
+	SampleEventDelegates(AppInstance& instance, nos::app::IAppServiceClient* client) : Instance(instance), Client(client) {}
+
+	AppInstance& Instance;
+	nos::app::IAppServiceClient* Client;
+	// Render thread only, set by the task CreateTexturePinsInNodos pushes
+	nos::fb::UUID NodeId{};
+
+	void HandleEvent(const nos::app::EngineEvent* event);
+
+	void OnAppConnected(const nos::fb::Node* appNode);
+	void OnNodeUpdated(nos::fb::Node const& appNode);
+	void OnNodeImported(nos::fb::Node const& appNode);
+	void OnNodeRemoved();
+	void OnPinValueChanged(nos::fb::UUID const& pinId, uint8_t const* data, size_t size, bool reset, uint64_t frameNumber);
+	void OnConnectionClosed() override;
+	void OnStateChanged(nos::app::ExecutionState newState);
+	void OnExecuteStart(nos::app::AppExecuteStart const* appExecuteStart);
+	void OnSyncSemaphoresFromNodos(nos::app::SyncSemaphoresFromNodos const* syncSemaphoresFromNodos);
+};
+
+// One Nodos app node served by this process, with its own connection, pins, semaphores and render graph.
+// Each instance renders on its own thread with its own context, sharing objects with the main window's context,
+// so waiting for one instance's frame never delays another. Tasks run on the render thread.
+// Instances without a client are driven locally (e.g. by benchmarks) and render into textures they own.
+struct AppInstance
+{
+	AppInstance(uint32_t index, nos::app::IAppServiceClient* client);
+	AppInstance(AppInstance const&) = delete;
+	AppInstance& operator=(AppInstance const&) = delete;
+	~AppInstance();
+
+	uint32_t Index;
+	nos::app::IAppServiceClient* Client;
+	std::unique_ptr<SampleEventDelegates> EventDelegates;
+	NodosState State;
+	TaskQueue Tasks;
+	RenderGraph Graph;
+	GraphResources Resources;
+	// Vertex arrays are per context, so the sample pass gets its own
+	GLuint VAO = 0;
+	// Reduced copies of the first output for the window
+	PreviewChannel Preview;
+	std::atomic<uint64_t> RenderedFrames = 0;
+	// Started frames passed over with --late-frames
+	std::atomic<uint64_t> SkippedFrames = 0;
+	// GL state changes the render thread issued and skipped as redundant, updated after every frame
+	std::atomic<uint64_t> StateChangesIssued = 0;
+	std::atomic<uint64_t> StateChangesElided = 0;
+	// Framebuffer, program and vertex array binds issued beyond what the render graph needs in frames that started
+	// from the bindings of the previous one, none unless something drops the cache's bindings needlessly
+	std::atomic<uint64_t> RedundantBinds = 0;
+	// Published with --stats after every wake-up of the render thread, used only by the render thread
+	InstanceStats Stats;
+	// With --frame-budget, used only by the render thread
+	GpuTimer FrameTimer;
+	// Time the GPU waited on the input semaphore, used only by the render thread
+	GpuTimer SemaphoreTimer;
+	ResolutionController Resolution;
+	// Set with --record, used only by the render thread
+	std::unique_ptr<FrameRecorder> Recorder;
+	// Set before Start for instances fed from --source instead of Nodos, used only by the render thread
+	std::unique_ptr<FileSource> Source;
+	// Set before Start with --compare, every rendered frame is checked against it
+	std::unique_ptr<GoldenComparator> Golden;
+	// Set with --record-events before the client is connected
+	std::unique_ptr<EventRecorder> EventLog;
+
+	// Takes ownership of context (created with CreateSharedContext) and starts the render thread.
+	// Returns false without starting if context is null, i.e. it could not be created.
+	bool Start(GLFWwindow* context);
+	// Stops the render thread and returns the context, which must be destroyed on the main thread
+	GLFWwindow* Stop();
+
+	void InitGL();
+	void ShutdownGL();
+	void BuildRenderGraph();
+	// For instances without a client: creates textures and buffers owned by the instance for every pin
+	void CreateLocalTextures(uint32_t width, uint32_t height);
+
+	// Imports the buffer described by a nos.sys.vulkan.Buffer pin value
+	void UpdateBufferPin(uint32_t index, uint8_t const* value);
+	// Bytes imported for every pin together
+	uint64_t GetImportedBytes() const;
+	// Whether an import of bytes replacing one of released bytes fits in --memory-budget, evicting unused pooled
+	// textures if it would not otherwise
+	bool ReserveMemory(uint64_t bytes, uint64_t released);
+	// Logs the memory held by each pin, the pool and the total against the budget
+	void LogMemoryUsage();
+
+	// SDK thread: creates or matches the node's pins and sends them to Nodos, the slots are updated by a task
+	void CreateTexturePinsInNodos(const nos::fb::Node& appNode);
+	void UpdateSyncState(nos::app::ExecutionState newState);
+	void DeleteSyncSemaphores();
+	void ResetState();
+
+	// Synced with Nodos and every texture and semaphore is imported
+	bool IsReadyToRender();
+	// Nodos started executing the frame this instance should render next, or went idle
+	bool IsFrameStartedOrIdle();
+	bool IsIdle();
+	// Waits for the input semaphore, renders and signals Nodos. Returns false if nothing was rendered.
+	bool RenderFrame();
+
+private:
+	void RenderThread();
+	PublishResult PublishPreview();
+	// Counts the binds a frame issued since before against what the graph needs when the previous frame's bindings
+	// are still current. Called after every rendered frame, whatever happened before it.
+	void CheckSteadyStateBinds(GLBindCounts const& before, uint64_t compileCount);
+	bool IsFrameStartedOrIdleLocked() const;
+	// Called with the execution state mutex held before rendering, applies --late-frames
+	void SkipLateFramesLocked();
+	// Called with the execution state mutex held when no frame started within the watchdog timeout
+	void RecoverFromStallLocked(std::chrono::steady_clock::duration stalledFor);
+
+	GLFWwindow* Context = nullptr;
+	std::thread Thread;
+	std::atomic_bool StopRequested = false;
+	// Render thread only: last time a frame was rendered or the instance had nothing to wait for
+	std::chrono::steady_clock::time_point LastProgressTime;
+	bool Stalled = false;
+	std::chrono::steady_clock::time_point LastMemoryReport;
+	// With --spin-wait, places the spin window
+	FrameStartPredictor FrameStarts;
+	std::chrono::steady_clock::time_point SeenFrameStartTime;
+	// Render thread only: whether the bindings the last frame left are still current, and the preview's program is
+	// the only one bound over them
+	bool BindingsKept = false;
+	bool PreviewBound = false;
+};
+
+// Wakes a thread waiting on any instance, signaled on every frame start, frame completion and execution state change
+uint64_t GetFrameEventCount();
+void NotifyFrameEvent();
+// Returns false if no event arrived within timeout
+bool WaitForFrameEvent(uint64_t seenCount, std::chrono::milliseconds timeout);
+
+std::string GetTexturePinName(bool isOutput, uint32_t index);
+std::string GetBufferPinName(uint32_t index);
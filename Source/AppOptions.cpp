@@ -0,0 +1,425 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "AppOptions.h"
+#include "Shaders.h"
+
+#include <iostream>
+#include <string_view>
+#include <charconv>
+
+static std::vector<std::string> SplitList(std::string_view list)
+{
+	std::vector<std::string> items;
+	while (!list.empty())
+	{
+		auto comma = list.find(',');
+		auto item = list.substr(0, comma);
+		if (!item.empty())
+			items.emplace_back(item);
+		if (comma == std::string_view::npos)
+			break;
+		list.remove_prefix(comma + 1);
+	}
+	return items;
+}
+
+static std::optional<uint32_t> ParseCount(std::string_view arg, std::string_view value, uint32_t min, uint32_t max)
+{
+	uint32_t count = 0;
+	auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+	if (ec != std::errc() || end != value.data() + value.size() || count < min || count > max)
+	{
+		std::cerr << "Invalid value for " << arg << ": " << value << " (expected " << min << "-" << max << ")" << std::endl;
+		return std::nullopt;
+	}
+	return count;
+}
+
+// N=mips:L[,array:D|,3d:D]
+static bool ParseInputShape(std::string_view arg, std::string_view value, AppOptions& options)
+{
+	auto equals = value.find('=');
+	if (equals == std::string_view::npos)
+	{
+		std::cerr << "Invalid value for " << arg << ": " << value << " (expected N=mips:L[,array:D|,3d:D])" << std::endl;
+		return false;
+	}
+	auto index = ParseCount(arg, value.substr(0, equals), 0, 15);
+	if (!index)
+		return false;
+	TextureShape shape{};
+	for (auto& item : SplitList(value.substr(equals + 1)))
+	{
+		std::string_view part = item;
+		auto colon = part.find(':');
+		auto key = part.substr(0, colon);
+		if (colon == std::string_view::npos || (key != "mips" && key != "array" && key != "3d"))
+		{
+			std::cerr << "Invalid value for " << arg << ": " << item << " (expected mips:L, array:D or 3d:D)" << std::endl;
+			return false;
+		}
+		auto count = ParseCount(arg, part.substr(colon + 1), 1, key == "mips" ? 16 : 2048);
+		if (!count)
+			return false;
+		if (key == "mips")
+			shape.Levels = *count;
+		else
+		{
+			shape.Target = key == "3d" ? GL_TEXTURE_3D : GL_TEXTURE_2D_ARRAY;
+			shape.Depth = *count;
+		}
+	}
+	options.InputShapes[*index] = shape;
+	return true;
+}
+
+std::optional<AppOptions> ParseOptions(int argc, char** argv)
+{
+	AppOptions options{};
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		auto nextValue = [&]() -> std::optional<std::string_view> {
+			if (i + 1 >= argc)
+			{
+				std::cerr << "Missing value for " << arg << std::endl;
+				return std::nullopt;
+			}
+			return argv[++i];
+		};
+		if (arg == "--effects")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			options.Effects = SplitList(*value);
+			for (auto& effect : options.Effects)
+			{
+				if (!IsKnownEffect(effect))
+				{
+					std::cerr << "Unknown effect: " << effect << std::endl;
+					return std::nullopt;
+				}
+			}
+		}
+		else if (arg == "--inputs" || arg == "--outputs")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			// Minimums guaranteed by GL 4.5 for fragment texture units and draw buffers
+			auto count = ParseCount(arg, *value, 1, arg == "--inputs" ? 16 : 8);
+			if (!count)
+				return std::nullopt;
+			(arg == "--inputs" ? options.InputCount : options.OutputCount) = *count;
+		}
+		else if (arg == "--buffers")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			// Minimum guaranteed by GL 4.5 for fragment and compute shader storage blocks
+			auto count = ParseCount(arg, *value, 0, 8);
+			if (!count)
+				return std::nullopt;
+			options.BufferCount = *count;
+		}
+		else if (arg == "--input-shape")
+		{
+			auto value = nextValue();
+			if (!value || !ParseInputShape(arg, *value, options))
+				return std::nullopt;
+		}
+		else if (arg == "--import-dedicated" || arg == "--import-tiling")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			bool isDedicated = arg == "--import-dedicated";
+			std::string_view yes = isDedicated ? "yes" : "linear", no = isDedicated ? "no" : "optimal";
+			if (*value != yes && *value != no)
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected " << yes << " or " << no << ")" << std::endl;
+				return std::nullopt;
+			}
+			(isDedicated ? options.ImportDedicated : options.ImportLinearTiling) = *value == yes;
+		}
+		else if (arg == "--instances")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto count = ParseCount(arg, *value, 1, 64);
+			if (!count)
+				return std::nullopt;
+			options.InstanceCount = *count;
+		}
+		else if (arg == "--benchmark-scaling" || arg == "--benchmark-seconds")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			bool isScaling = arg == "--benchmark-scaling";
+			auto count = ParseCount(arg, *value, 1, isScaling ? 64 : 600);
+			if (!count)
+				return std::nullopt;
+			if (isScaling)
+				options.BenchmarkScaling = *count;
+			else
+				options.BenchmarkSeconds = *count;
+		}
+		else if (arg == "--record")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			options.RecordPath = *value;
+		}
+		else if (arg == "--source")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			options.SourcePath = *value;
+		}
+		else if (arg == "--source-size")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto x = value->find('x');
+			if (x == std::string_view::npos)
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected WxH)" << std::endl;
+				return std::nullopt;
+			}
+			auto width = ParseCount(arg, value->substr(0, x), 1, 16384);
+			auto height = ParseCount(arg, value->substr(x + 1), 1, 16384);
+			if (!width || !height)
+				return std::nullopt;
+			options.SourceWidth = *width;
+			options.SourceHeight = *height;
+		}
+		else if (arg == "--compare")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			options.ComparePath = *value;
+		}
+		else if (arg == "--compare-tolerance" || arg == "--frames")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			bool isTolerance = arg == "--compare-tolerance";
+			auto count = ParseCount(arg, *value, isTolerance ? 0 : 1, isTolerance ? 255 : 1000000);
+			if (!count)
+				return std::nullopt;
+			(isTolerance ? options.CompareTolerance : options.FrameCount) = *count;
+		}
+		else if (arg == "--record-events" || arg == "--replay-events")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			(arg == "--record-events" ? options.RecordEventsPath : options.ReplayEventsPath) = *value;
+		}
+		else if (arg == "--replay-speed")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			double speed = 0;
+			auto [end, ec] = std::from_chars(value->data(), value->data() + value->size(), speed);
+			if (ec != std::errc() || end != value->data() + value->size() || speed < 0)
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected a non-negative number)" << std::endl;
+				return std::nullopt;
+			}
+			options.ReplaySpeed = speed;
+		}
+		else if (arg == "--headless")
+		{
+			options.Headless = true;
+		}
+		else if (arg == "--check-orientation")
+		{
+			options.CheckOrientation = true;
+		}
+		else if (arg == "--late-frames")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			if (*value == "all")
+				options.LateFrames = LateFramePolicy::RenderAll;
+			else if (*value == "latest")
+				options.LateFrames = LateFramePolicy::DropToLatest;
+			else if (value->starts_with("lag:"))
+			{
+				auto lag = ParseCount(arg, value->substr(4), 1, 1000);
+				if (!lag)
+					return std::nullopt;
+				options.LateFrames = LateFramePolicy::MaxLag;
+				options.MaxFrameLag = *lag;
+			}
+			else
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected all, latest or lag:N)" << std::endl;
+				return std::nullopt;
+			}
+		}
+		else if (arg == "--watchdog-timeout")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto timeout = ParseCount(arg, *value, 0, 600000);
+			if (!timeout)
+				return std::nullopt;
+			options.WatchdogTimeoutMs = *timeout;
+		}
+		else if (arg == "--spin-wait")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto window = ParseCount(arg, *value, 0, 100000);
+			if (!window)
+				return std::nullopt;
+			options.SpinWaitMicroseconds = *window;
+		}
+		else if (arg == "--benchmark-wakeup")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto rate = ParseCount(arg, *value, 1, 10000);
+			if (!rate)
+				return std::nullopt;
+			options.BenchmarkWakeup = *rate;
+		}
+		else if (arg == "--frame-budget")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			double budget = 0;
+			auto [end, ec] = std::from_chars(value->data(), value->data() + value->size(), budget);
+			if (ec != std::errc() || end != value->data() + value->size() || budget < 0)
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected a non-negative number of milliseconds)" << std::endl;
+				return std::nullopt;
+			}
+			options.FrameBudgetMs = budget;
+		}
+		else if (arg == "--memory-budget")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto budget = ParseCount(arg, *value, 0, 1 << 20);
+			if (!budget)
+				return std::nullopt;
+			options.MemoryBudgetMB = *budget;
+		}
+		else if (arg == "--memory-report")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto seconds = ParseCount(arg, *value, 0, 86400);
+			if (!seconds)
+				return std::nullopt;
+			options.MemoryReportSeconds = *seconds;
+		}
+		else if (arg == "--stats")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			if (value->empty() || value->find_first_of("/\\") != std::string_view::npos)
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected a name without slashes)" << std::endl;
+				return std::nullopt;
+			}
+			options.StatsName = *value;
+		}
+		else if (arg == "--log-level")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			if (*value == "debug")
+				options.LogLevel = LogSeverity::Debug;
+			else if (*value == "info")
+				options.LogLevel = LogSeverity::Info;
+			else if (*value == "warning")
+				options.LogLevel = LogSeverity::Warning;
+			else if (*value == "error")
+				options.LogLevel = LogSeverity::Error;
+			else
+			{
+				std::cerr << "Invalid value for " << arg << ": " << *value << " (expected debug, info, warning or error)" << std::endl;
+				return std::nullopt;
+			}
+		}
+		else if (arg == "--log-rate")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto rate = ParseCount(arg, *value, 0, 100000);
+			if (!rate)
+				return std::nullopt;
+			options.LogRate = *rate;
+		}
+		else if (arg == "--preview-rate")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto rate = ParseCount(arg, *value, 0, 1000);
+			if (!rate)
+				return std::nullopt;
+			options.PreviewRate = *rate;
+		}
+		else if (arg == "--record-fps")
+		{
+			auto value = nextValue();
+			if (!value)
+				return std::nullopt;
+			auto fps = ParseCount(arg, *value, 1, 1000);
+			if (!fps)
+				return std::nullopt;
+			options.RecordFps = *fps;
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << arg << std::endl;
+			return std::nullopt;
+		}
+	}
+	if (!options.InputShapes.empty() && options.InputShapes.rbegin()->first >= options.InputCount)
+	{
+		std::cerr << "--input-shape refers to input " << options.InputShapes.rbegin()->first << " but there are only " << options.InputCount << " inputs" << std::endl;
+		return std::nullopt;
+	}
+	for (auto& effect : options.Effects)
+	{
+		if (GetEffectBufferCount(effect) > options.BufferCount)
+		{
+			std::cerr << "Effect " << effect << " needs " << GetEffectBufferCount(effect) << " buffer inputs (--buffers)" << std::endl;
+			return std::nullopt;
+		}
+	}
+	if (!options.ComparePath.empty() && (options.SourcePath.empty() || !options.RecordPath.empty()))
+	{
+		std::cerr << "--compare needs --source and can't be combined with --record" << std::endl;
+		return std::nullopt;
+	}
+	return options;
+}
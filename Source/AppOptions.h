@@ -0,0 +1,103 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <cstdint>
+
+#include "Formats.h"
+#include "Log.h"
+
+// What an instance does when Nodos started frames it has not rendered yet
+enum class LateFramePolicy
+{
+	// Renders every started frame in turn, latency grows until it catches up
+	RenderAll,
+	// Jumps to the last started frame
+	DropToLatest,
+	// Renders at most MaxFrameLag frames behind the last started one
+	MaxLag,
+};
+
+struct AppOptions
+{
+	// Effects applied after the sample shader, in order (e.g. --effects blur,grade,sharpen)
+	std::vector<std::string> Effects;
+	// Number of texture input and output pins, outputs are rendered together as multiple render targets
+	uint32_t InputCount = 1;
+	uint32_t OutputCount = 1;
+	// --buffers N: buffer input pins, imported from Nodos and bound to SSBO binding points 0..N-1 of every pass
+	uint32_t BufferCount = 0;
+	// --input-shape N=mips:L[,array:D|,3d:D]: imports input N as a mip chain, 2D array or volume (e.g. a LUT) as allocated by Nodos
+	std::map<uint32_t, TextureShape> InputShapes;
+	// --import-dedicated yes|no and --import-tiling optimal|linear: override the memory layout derived from the texture description
+	std::optional<bool> ImportDedicated;
+	std::optional<bool> ImportLinearTiling;
+	// --preview-rate N: shows every Nth frame of each instance in the window, 0 disables the preview
+	uint32_t PreviewRate = 1;
+	// Number of Nodos app nodes served by this process, each rendering on its own thread and sharing shader programs
+	uint32_t InstanceCount = 1;
+	// --benchmark-scaling N: render without Nodos on 1, 2, 4... up to N instances and report throughput
+	std::optional<uint32_t> BenchmarkScaling;
+	// --benchmark-wakeup HZ: measure how long a thread takes to wake for frame starts HZ times a second, sleeping or spinning
+	std::optional<uint32_t> BenchmarkWakeup;
+	uint32_t BenchmarkSeconds = 5;
+	// --record file.y4m|file.raw: streams the first output of every instance to disk
+	std::string RecordPath;
+	// Frame rate written to the Y4M header
+	uint32_t RecordFps = 60;
+	// --source file.y4m|file.raw: plays the file into every input instead of connecting to Nodos
+	std::string SourcePath;
+	// --source-size WxH, required for raw files
+	uint32_t SourceWidth = 0;
+	uint32_t SourceHeight = 0;
+	// --compare reference.raw: with --source, compares the first output of every frame against a recording made with --record
+	// and exits with an error if any channel differs by more than --compare-tolerance
+	std::string ComparePath;
+	uint32_t CompareTolerance = 1;
+	// --frames N: with --source, stops after N frames per instance
+	uint32_t FrameCount = 0;
+	// --check-orientation: checks that effects and 4:2:2 packing keep outputs the same way up, then exits
+	bool CheckOrientation = false;
+	// --headless: keeps the window hidden, e.g. for CI with LIBGL_ALWAYS_SOFTWARE=1 (llvmpipe)
+	bool Headless = false;
+	// --record-events file: appends every event each instance receives from Nodos, with timestamps
+	std::string RecordEventsPath;
+	// --replay-events file: feeds a recorded event stream to the instances instead of connecting to Nodos
+	std::string ReplayEventsPath;
+	// Multiplier on the recorded pace, 0 replays back to back
+	double ReplaySpeed = 1.0;
+	// --late-frames all|latest|lag:N: live output prefers fresh frames, so frames a late instance can't catch up with are skipped
+	LateFramePolicy LateFrames = LateFramePolicy::DropToLatest;
+	uint32_t MaxFrameLag = 0;
+	// --watchdog-timeout MS: when Nodos starts no frame for this long while executing, the instance assumes an event was lost,
+	// signals Nodos that rendering was submitted and takes the next frame start's number as its own. 0 waits forever.
+	uint32_t WatchdogTimeoutMs = 2000;
+	// --spin-wait US: spins instead of sleeping around the time the next frame is expected to start, trading CPU for
+	// wake-up latency. The window follows the jitter of the frame starts and is skipped if it would reach further than
+	// US to either side of the prediction. 0 always sleeps.
+	uint32_t SpinWaitMicroseconds = 0;
+	// --frame-budget MS: measures the GPU time of every frame and renders the effects at a reduced resolution, upsampled
+	// into the outputs, while frames don't fit in the budget. 0 always renders at the output resolution.
+	double FrameBudgetMs = 0;
+	// --memory-budget MB: most video memory an instance may hold in imported pins and pooled render targets.
+	// Imports that would exceed it first evict unused pooled textures, then fail. 0 for no limit.
+	uint32_t MemoryBudgetMB = 0;
+	// --memory-report S: logs each instance's memory use every S seconds, 0 disables
+	uint32_t MemoryReportSeconds = 60;
+	// --stats NAME: publishes each instance's counters in the shared memory segment NAME for Tools/StatsReader
+	std::string StatsName;
+	// --log-level debug|info|warning|error: least severe message shown
+	LogSeverity LogLevel = LogSeverity::Info;
+	// --log-rate N: messages per second each call site may log, 0 for no limit
+	uint32_t LogRate = 10;
+};
+
+std::optional<AppOptions> ParseOptions(int argc, char** argv);
+
+extern AppOptions g_Options;
@@ -0,0 +1,264 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Benchmark.h"
+#include "AppOptions.h"
+#include "LocalDriver.h"
+#include "WakeEvent.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include "Windows.h"
+#else
+#include <time.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+struct ScalingResult
+{
+	uint32_t InstanceCount;
+	double Seconds;
+	std::vector<uint64_t> Frames;
+	// GL state changes over the measured frames of every instance
+	uint64_t StateChangesIssued = 0;
+	uint64_t StateChangesElided = 0;
+	// Binds steady-state frames issued beyond what their render graph needs
+	uint64_t RedundantBinds = 0;
+};
+
+// Measures --benchmark-seconds after a second of warm-up, returns no frames if the instances could not start
+static ScalingResult MeasureInstances(GLFWwindow* mainWindow, uint32_t instanceCount)
+{
+	LocalDriver driver;
+	if (!driver.Start(mainWindow, instanceCount))
+		return {};
+	auto pump = [&]() { driver.Pump(std::chrono::milliseconds(100)); };
+	auto snapshot = [&]()
+		{
+			std::vector<uint64_t> frames;
+			for (auto& instance : driver.Instances)
+				frames.push_back(instance->RenderedFrames);
+			return frames;
+		};
+	auto stateChanges = [&]()
+		{
+			std::pair<uint64_t, uint64_t> changes;
+			for (auto& instance : driver.Instances)
+			{
+				changes.first += instance->StateChangesIssued;
+				changes.second += instance->StateChangesElided;
+			}
+			return changes;
+		};
+	auto redundantBinds = [&]()
+		{
+			uint64_t binds = 0;
+			for (auto& instance : driver.Instances)
+				binds += instance->RedundantBinds;
+			return binds;
+		};
+
+	auto warmupEnd = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (std::chrono::steady_clock::now() < warmupEnd)
+		pump();
+
+	auto start = std::chrono::steady_clock::now();
+	auto startFrames = snapshot();
+	auto startChanges = stateChanges();
+	auto startRedundant = redundantBinds();
+	auto end = start + std::chrono::seconds(g_Options.BenchmarkSeconds);
+	while (std::chrono::steady_clock::now() < end)
+		pump();
+	auto endFrames = snapshot();
+	auto endChanges = stateChanges();
+	auto endRedundant = redundantBinds();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	driver.Stop();
+
+	ScalingResult result{ .InstanceCount = instanceCount, .Seconds = seconds,
+		.StateChangesIssued = endChanges.first - startChanges.first, .StateChangesElided = endChanges.second - startChanges.second,
+		.RedundantBinds = endRedundant - startRedundant };
+	for (uint32_t i = 0; i < instanceCount; ++i)
+		result.Frames.push_back(endFrames[i] - startFrames[i]);
+	return result;
+}
+
+int RunScalingBenchmark(GLFWwindow* mainWindow)
+{
+	// Nothing is shown, keep the main thread's swaps from throttling anything
+	glfwSwapInterval(0);
+	std::cout << "Scaling benchmark: " << (g_Options.SourcePath.empty() ? "1920x1080" : g_Options.SourcePath) << ", " << g_Options.InputCount << " input(s), " << g_Options.OutputCount << " output(s), "
+		<< g_Options.Effects.size() << " effect(s), " << g_Options.BenchmarkSeconds << "s per run" << std::endl;
+	double singleFps = 0;
+	for (uint32_t count = 1; count <= *g_Options.BenchmarkScaling; count *= 2)
+	{
+		auto result = MeasureInstances(mainWindow, count);
+		if (result.Frames.empty())
+			return -1;
+		uint64_t total = 0;
+		for (auto frames : result.Frames)
+			total += frames;
+		double fps = total / result.Seconds;
+		if (count == 1)
+			singleFps = fps;
+		std::cout << std::fixed << std::setprecision(1)
+			<< "Instances: " << count << ", total: " << fps << " fps"
+			<< " (" << (singleFps > 0 ? fps / singleFps : 0) << "x), per instance:";
+		for (auto frames : result.Frames)
+			std::cout << " " << frames / result.Seconds;
+		if (total)
+			std::cout << ", state changes per frame: " << double(result.StateChangesIssued) / total << " issued, "
+				<< double(result.StateChangesElided) / total << " elided";
+		std::cout << std::endl;
+		if (total == 0)
+		{
+			std::cerr << "No frames rendered with " << count << " instance(s)" << std::endl;
+			return -1;
+		}
+		// Nothing changes the graph or its pins while measuring, so every bind beyond what it needs is a regression
+		if (result.RedundantBinds)
+		{
+			std::cerr << result.RedundantBinds << " redundant framebuffer, program or vertex array bind(s) with " << count << " instance(s)" << std::endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+enum class WakeupMode
+{
+	ConditionVariable,
+	Event,
+	Spin,
+};
+
+struct WakeupResult
+{
+	// Sorted
+	std::vector<std::chrono::nanoseconds> Latencies;
+	double CpuSeconds = 0;
+	double Seconds = 0;
+};
+
+static double GetThreadCpuSeconds()
+{
+#if defined(_WIN32)
+	FILETIME creation, exit, kernel, user;
+	GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+	auto toSeconds = [](FILETIME time) { return double((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7; };
+	return toSeconds(kernel) + toSeconds(user);
+#else
+	timespec time{};
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return double(time.tv_sec) + double(time.tv_nsec) * 1e-9;
+#endif
+}
+
+// Waits the way the render thread does, for frame starts a second thread publishes under a mutex like OnExecuteStart
+static WakeupResult MeasureWakeups(WakeupMode mode, uint32_t rate, std::chrono::nanoseconds maxSpin)
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+	WakeEvent event;
+	uint64_t started = 0;
+	std::chrono::steady_clock::time_point startTime;
+	bool stop = false;
+	auto period = std::chrono::nanoseconds(std::chrono::seconds(1)) / rate;
+	std::thread producer([&]()
+		{
+			// Nodos paces frames from its own clock, starts arrive within a few percent of the period
+			std::mt19937 random(1);
+			std::uniform_int_distribution<int64_t> jitter(-period.count() / 40, period.count() / 40);
+			auto next = std::chrono::steady_clock::now() + period;
+			auto end = next + std::chrono::seconds(g_Options.BenchmarkSeconds);
+			while (next < end)
+			{
+				std::this_thread::sleep_until(next + std::chrono::nanoseconds(jitter(random)));
+				{
+					std::unique_lock lock(mutex);
+					started++;
+					startTime = std::chrono::steady_clock::now();
+				}
+				mode == WakeupMode::ConditionVariable ? cv.notify_all() : event.Signal();
+				next += period;
+			}
+			{
+				std::unique_lock lock(mutex);
+				stop = true;
+			}
+			cv.notify_all();
+			event.Signal();
+		});
+
+	WakeupResult result;
+	FrameStartPredictor predictor(maxSpin);
+	uint64_t seen = 0;
+	auto cpuStart = GetThreadCpuSeconds();
+	auto wallStart = std::chrono::steady_clock::now();
+	{
+		std::unique_lock lock(mutex);
+		auto wakeUp = [&]() { return stop || started != seen; };
+		while (true)
+		{
+			if (mode == WakeupMode::ConditionVariable)
+				cv.wait(lock, wakeUp);
+			else
+				event.Wait(lock, wakeUp, mode == WakeupMode::Spin ? predictor.GetSpinWindow() : std::nullopt);
+			auto now = std::chrono::steady_clock::now();
+			if (stop)
+				break;
+			result.Latencies.push_back(now - startTime);
+			predictor.OnFrameStart(startTime);
+			seen = started;
+		}
+	}
+	result.CpuSeconds = GetThreadCpuSeconds() - cpuStart;
+	result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	producer.join();
+	// The first starts teach the predictor
+	result.Latencies.erase(result.Latencies.begin(), result.Latencies.begin() + std::min<size_t>(result.Latencies.size(), 30));
+	std::sort(result.Latencies.begin(), result.Latencies.end());
+	return result;
+}
+
+int RunWakeupBenchmark()
+{
+	uint32_t rate = *g_Options.BenchmarkWakeup;
+	auto maxSpin = std::chrono::microseconds(g_Options.SpinWaitMicroseconds ? g_Options.SpinWaitMicroseconds : 500);
+	std::cout << "Wake-up benchmark: " << rate << " frame starts per second, " << g_Options.BenchmarkSeconds << "s per waiter, spin window up to "
+		<< maxSpin.count() << " us to either side" << std::endl;
+	std::pair<WakeupMode, char const*> modes[] = {
+		{ WakeupMode::ConditionVariable, "condition variable" },
+		{ WakeupMode::Event, "wake event" },
+		{ WakeupMode::Spin, "spin, then wake event" },
+	};
+	for (auto [mode, name] : modes)
+	{
+		auto result = MeasureWakeups(mode, rate, maxSpin);
+		if (result.Latencies.empty())
+		{
+			std::cerr << "No frame starts seen by " << name << std::endl;
+			return -1;
+		}
+		auto percentile = [&](double p) {
+			size_t index = std::min(result.Latencies.size() - 1, size_t(p / 100 * double(result.Latencies.size())));
+			return double(result.Latencies[index].count()) / 1000;
+		};
+		std::cout << std::fixed << std::setprecision(1)
+			<< std::setw(22) << std::left << name << std::right << " latency us: p50 " << percentile(50) << ", p90 " << percentile(90) << ", p99 " << percentile(99)
+			<< ", p99.9 " << percentile(99.9) << ", max " << double(result.Latencies.back().count()) / 1000
+			<< " over " << result.Latencies.size() << " starts, waiter CPU " << result.CpuSeconds / result.Seconds * 100 << "%" << std::endl;
+	}
+	return 0;
+}
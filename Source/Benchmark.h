@@ -0,0 +1,16 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+struct GLFWwindow;
+
+// Renders on 1, 2, 4... up to --benchmark-scaling instances without Nodos, feeding each instance synthetic
+// engine events so the per-instance threads run exactly as they would when driven by Nodos. Inputs are fed from --source if set.
+// Prints aggregate and per-instance frames per second for every instance count. Returns the process exit code.
+int RunScalingBenchmark(GLFWwindow* mainWindow);
+// Simulates frame starts at --benchmark-wakeup HZ with a little jitter and measures, for --benchmark-seconds each, how late
+// a waiting thread sees them when parked on a condition variable, on a WakeEvent and spinning with --spin-wait
+// (500 us if unset). Prints latency percentiles and the waiter's CPU use. Needs no window or GL.
+int RunWakeupBenchmark();
@@ -0,0 +1,111 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "DynamicResolution.h"
+
+#include <iterator>
+
+void GpuTimer::Begin()
+{
+	if (!Queries[0])
+		glCreateQueries(GL_TIME_ELAPSED, GLsizei(Queries.size()), Queries.data());
+	// Every query is still pending, skip measuring this frame rather than reuse one
+	if (Issued - Collected == Queries.size())
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, Queries[Issued % Queries.size()]);
+	Active = true;
+}
+
+void GpuTimer::End()
+{
+	if (!Active)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	Issued++;
+	Active = false;
+}
+
+std::optional<uint64_t> GpuTimer::CollectNext()
+{
+	if (Collected == Issued)
+		return std::nullopt;
+	GLuint query = Queries[Collected % Queries.size()];
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return std::nullopt;
+	GLuint64 result = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+	Collected++;
+	return result;
+}
+
+std::optional<uint64_t> GpuTimer::Collect()
+{
+	std::optional<uint64_t> elapsed;
+	while (auto next = CollectNext())
+		elapsed = next;
+	return elapsed;
+}
+
+uint64_t GpuTimer::CollectTotal()
+{
+	uint64_t total = 0;
+	while (auto next = CollectNext())
+		total += *next;
+	return total;
+}
+
+void GpuTimer::Release()
+{
+	if (Queries[0])
+		glDeleteQueries(GLsizei(Queries.size()), Queries.data());
+	Queries = {};
+	Issued = Collected = 0;
+	Active = false;
+}
+
+// Halving the width and height is the most the output can lose before upsampling is too visible
+static const float Scales[] = { 1.0f, 0.875f, 0.75f, 0.625f, 0.5f };
+// Fraction of the budget above which a frame counts as over
+constexpr double OverThreshold = 0.95;
+// Fraction of the budget the predicted time at the next larger scale must stay under
+constexpr double UnderThreshold = 0.8;
+constexpr uint32_t FramesBeforeDown = 4;
+constexpr uint32_t FramesBeforeUp = 60;
+
+float ResolutionController::Update(double gpuMilliseconds)
+{
+	Average = Average == 0 ? gpuMilliseconds : Average * 0.9 + gpuMilliseconds * 0.1;
+	auto stepTo = [this](uint32_t step) {
+		// GPU time of the effect chain goes with the number of pixels
+		double ratio = Scales[step] / Scales[Step];
+		Average *= ratio * ratio;
+		Step = step;
+		FramesOver = FramesUnder = 0;
+	};
+	if (gpuMilliseconds > Budget * OverThreshold)
+	{
+		FramesUnder = 0;
+		if (++FramesOver >= FramesBeforeDown && Step + 1 < std::size(Scales))
+			stepTo(Step + 1);
+	}
+	else if (Step > 0)
+	{
+		FramesOver = 0;
+		double ratio = Scales[Step - 1] / Scales[Step];
+		if (Average * ratio * ratio >= Budget * UnderThreshold)
+			FramesUnder = 0;
+		else if (++FramesUnder >= FramesBeforeUp)
+			stepTo(Step - 1);
+	}
+	else
+		FramesOver = 0;
+	return Scales[Step];
+}
+
+float ResolutionController::GetScale() const
+{
+	return Scales[Step];
+}
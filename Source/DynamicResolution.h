@@ -0,0 +1,62 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include <glad/glad.h>
+
+// Measures GPU time between Begin and End with a ring of timer queries, results are read a few frames later
+// once available so the render thread never waits for the GPU. Must be used on a single context.
+class GpuTimer
+{
+public:
+	GpuTimer() = default;
+	GpuTimer(GpuTimer const&) = delete;
+	GpuTimer& operator=(GpuTimer const&) = delete;
+
+	void Begin();
+	void End();
+	// Time of the oldest measured frame whose result is available, in nanoseconds
+	std::optional<uint64_t> Collect();
+	// Sum of every measurement whose result became available since the last call, in nanoseconds
+	uint64_t CollectTotal();
+	// Must be called while the context is current
+	void Release();
+
+private:
+	// Result of the oldest pending query if it is available
+	std::optional<uint64_t> CollectNext();
+
+	std::array<GLuint, 4> Queries = {};
+	// Queries issued and not yet collected, oldest first starting at Collected
+	uint64_t Issued = 0;
+	uint64_t Collected = 0;
+	bool Active = false;
+};
+
+// Picks the internal resolution of the effect chain from measured GPU frame times.
+// Steps down after a few frames over budget and up only after a long run of frames that would still fit at the next
+// step, so the scale does not oscillate around the budget.
+class ResolutionController
+{
+public:
+	explicit ResolutionController(double budgetMilliseconds) : Budget(budgetMilliseconds) {}
+
+	// Returns the scale to render the next frame at
+	float Update(double gpuMilliseconds);
+	float GetScale() const;
+	// Smoothed GPU time at the current scale
+	double GetAverage() const { return Average; }
+
+private:
+	double Budget;
+	double Average = 0;
+	uint32_t Step = 0;
+	uint32_t FramesOver = 0;
+	uint32_t FramesUnder = 0;
+};
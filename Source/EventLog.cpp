@@ -0,0 +1,168 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "EventLog.h"
+#include "Log.h"
+
+#include <cstring>
+
+static constexpr char EventLogMagic[8] = { 'N', 'O', 'S', 'E', 'V', 'L', 'O', 'G' };
+static constexpr uint32_t EventLogVersion = 1;
+
+struct EventLogHeader
+{
+	char Magic[8];
+	uint32_t Version;
+	uint32_t Reserved;
+};
+static_assert(sizeof(EventLogHeader) == 16);
+
+struct EventRecordHeader
+{
+	uint64_t TimeNs;
+	uint32_t Size;
+	EventRecordType Type;
+	uint8_t Reserved[3];
+};
+static_assert(sizeof(EventRecordHeader) == 16);
+
+static constexpr uint32_t PaddedSize(uint32_t size)
+{
+	return (size + 7) & ~7u;
+}
+
+std::unique_ptr<EventRecorder> EventRecorder::Open(std::string const& path)
+{
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		LogError("Failed to open ", path, " for recording events");
+		return nullptr;
+	}
+	EventLogHeader header{ .Version = EventLogVersion };
+	std::memcpy(header.Magic, EventLogMagic, sizeof(EventLogMagic));
+	std::fwrite(&header, sizeof(header), 1, file);
+	return std::unique_ptr<EventRecorder>(new EventRecorder(path, file));
+}
+
+EventRecorder::EventRecorder(std::string path, std::FILE* file)
+	: Path(std::move(path)), File(file), Start(std::chrono::steady_clock::now())
+{
+}
+
+EventRecorder::~EventRecorder()
+{
+	std::fclose(File);
+	LogInfo("Recorded ", Count, " events to ", Path);
+}
+
+void EventRecorder::Record(const nos::app::EngineEvent* event)
+{
+	// The event arrives without its buffer size, so it is copied out through the object API
+	std::unique_ptr<nos::app::TEngineEvent> unpacked(event->UnPack());
+	flatbuffers::FlatBufferBuilder fbb;
+	fbb.Finish(nos::app::CreateEngineEvent(fbb, unpacked.get()));
+	Append(EventRecordType::EngineEvent, fbb.GetBufferPointer(), fbb.GetSize());
+}
+
+void EventRecorder::RecordConnectionClosed()
+{
+	Append(EventRecordType::ConnectionClosed, nullptr, 0);
+}
+
+void EventRecorder::Append(EventRecordType type, const uint8_t* data, uint32_t size)
+{
+	auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start);
+	EventRecordHeader header{ .TimeNs = uint64_t(time.count()), .Size = size, .Type = type };
+	static constexpr uint8_t padding[8] = {};
+	std::unique_lock lock(Mutex);
+	std::fwrite(&header, sizeof(header), 1, File);
+	if (size)
+		std::fwrite(data, 1, size, File);
+	std::fwrite(padding, 1, PaddedSize(size) - size, File);
+	Count++;
+}
+
+std::unique_ptr<EventReplayer> EventReplayer::Open(std::string const& path)
+{
+	std::unique_ptr<EventReplayer> replayer(new EventReplayer());
+	replayer->File = MappedFile::Open(path);
+	if (!replayer->File)
+		return nullptr;
+	const uint8_t* data = replayer->File->Data;
+	size_t size = replayer->File->Size;
+	EventLogHeader header{};
+	if (size >= sizeof(header))
+		std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.Magic, EventLogMagic, sizeof(EventLogMagic)) != 0)
+	{
+		LogError("Not an event log: ", path);
+		return nullptr;
+	}
+	if (header.Version != EventLogVersion)
+	{
+		LogError("Event log ", path, " has version ", header.Version, ", expected ", EventLogVersion);
+		return nullptr;
+	}
+	size_t offset = sizeof(header);
+	size_t dropped = 0;
+	while (offset + sizeof(EventRecordHeader) <= size)
+	{
+		EventRecordHeader record;
+		std::memcpy(&record, data + offset, sizeof(record));
+		size_t recordOffset = offset;
+		offset += sizeof(record);
+		// A recording cut short by a crash ends with a partial record
+		if (offset + record.Size > size)
+			break;
+		// Events are read in place, so a corrupt or foreign one would read out of bounds
+		bool valid = record.Type == EventRecordType::ConnectionClosed;
+		if (record.Type == EventRecordType::EngineEvent)
+		{
+			flatbuffers::Verifier verifier(data + offset, record.Size);
+			valid = verifier.VerifyBuffer<nos::app::EngineEvent>(nullptr);
+		}
+		if (valid)
+			replayer->Records.push_back({ std::chrono::nanoseconds(record.TimeNs), record.Type, data + offset, record.Size });
+		else
+		{
+			LogWarning("Event log ", path, ": Dropping invalid record at offset ", recordOffset);
+			dropped++;
+		}
+		offset += PaddedSize(record.Size);
+	}
+	if (dropped)
+		LogWarning("Event log ", path, ": Dropped ", dropped, " invalid record(s)");
+	LogInfo("Event log ", path, ": ", replayer->Records.size(), " events over ", std::chrono::duration<double>(replayer->GetDuration()).count(), "s");
+	return replayer;
+}
+
+size_t EventReplayer::Replay(nos::app::IEventDelegates& delegates, double speed, std::atomic_bool const& stop, WakeEvent& stopEvent) const
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t replayed = 0;
+	for (auto& record : Records)
+	{
+		if (speed > 0)
+		{
+			// Recordings can have long gaps, closing the window must not wait for them
+			auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(record.Time / speed);
+			for (auto now = std::chrono::steady_clock::now(); !stop && now < due; now = std::chrono::steady_clock::now())
+				stopEvent.Wait(due - now);
+		}
+		if (stop)
+			break;
+		switch (record.Type)
+		{
+		case EventRecordType::EngineEvent:
+			delegates.HandleEvent(flatbuffers::GetRoot<nos::app::EngineEvent>(record.Data));
+			break;
+		case EventRecordType::ConnectionClosed:
+			delegates.OnConnectionClosed();
+			break;
+		}
+		replayed++;
+	}
+	return replayed;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Import.h"
+#include "FileSource.h"
+#include "WakeEvent.h"
+
+// Event log file layout: a 16 byte header ("NOSEVLOG", version, reserved) followed by records.
+// Each record is a 16 byte header (time since recording started in nanoseconds, payload size, type) and the payload
+// padded to 8 bytes, so every flatbuffer stays aligned when the file is mapped.
+enum class EventRecordType : uint8_t
+{
+	// Payload is a finished EngineEvent flatbuffer
+	EngineEvent,
+	ConnectionClosed,
+};
+
+// Appends every event reaching an instance's delegates to a file, safe to call from any thread
+struct EventRecorder
+{
+	// Returns nullptr if the file can't be created
+	static std::unique_ptr<EventRecorder> Open(std::string const& path);
+	EventRecorder(EventRecorder const&) = delete;
+	EventRecorder& operator=(EventRecorder const&) = delete;
+	~EventRecorder();
+
+	void Record(const nos::app::EngineEvent* event);
+	void RecordConnectionClosed();
+
+private:
+	EventRecorder(std::string path, std::FILE* file);
+	void Append(EventRecordType type, const uint8_t* data, uint32_t size);
+
+	std::string Path;
+	std::FILE* File;
+	std::chrono::steady_clock::time_point Start;
+	std::mutex Mutex;
+	uint64_t Count = 0;
+};
+
+// Feeds a recorded event stream back into delegates
+struct EventReplayer
+{
+	// Returns nullptr if the file can't be read or isn't an event log
+	static std::unique_ptr<EventReplayer> Open(std::string const& path);
+
+	struct Record
+	{
+		std::chrono::nanoseconds Time;
+		EventRecordType Type;
+		const uint8_t* Data;
+		uint32_t Size;
+	};
+	std::vector<Record> const& GetRecords() const { return Records; }
+	std::chrono::nanoseconds GetDuration() const { return Records.empty() ? std::chrono::nanoseconds(0) : Records.back().Time; }
+
+	// Dispatches every record at its recorded time divided by speed, or back to back if speed is 0.
+	// Returns the number of records replayed, which is less than all of them if stop was set.
+	// Signal stopEvent after setting stop to cut the wait for the next record short.
+	size_t Replay(nos::app::IEventDelegates& delegates, double speed, std::atomic_bool const& stop, WakeEvent& stopEvent) const;
+
+private:
+	EventReplayer() = default;
+
+	std::unique_ptr<MappedFile> File;
+	std::vector<Record> Records;
+};
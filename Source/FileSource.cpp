@@ -0,0 +1,281 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "FileSource.h"
+#include "Log.h"
+
+#include <filesystem>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include "Windows.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+std::unique_ptr<MappedFile> MappedFile::Open(std::string const& path)
+{
+	std::unique_ptr<MappedFile> file(new MappedFile());
+#if defined(_WIN32)
+	file->File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file->File == INVALID_HANDLE_VALUE)
+	{
+		file->File = nullptr;
+		LogError("Failed to open ", path);
+		return nullptr;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file->File, &size) || size.QuadPart == 0)
+	{
+		LogError("Failed to get size of ", path);
+		return nullptr;
+	}
+	file->Size = size_t(size.QuadPart);
+	file->Mapping = CreateFileMappingA(file->File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!file->Mapping)
+	{
+		LogError("Failed to map ", path);
+		return nullptr;
+	}
+	file->Data = static_cast<const uint8_t*>(MapViewOfFile(file->Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		LogError("Failed to open ", path);
+		return nullptr;
+	}
+	struct stat st {};
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		LogError("Failed to get size of ", path);
+		close(fd);
+		return nullptr;
+	}
+	file->Size = size_t(st.st_size);
+	void* data = mmap(nullptr, file->Size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file referenced
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		LogError("Failed to map ", path);
+		return nullptr;
+	}
+	madvise(data, file->Size, MADV_SEQUENTIAL);
+	file->Data = static_cast<const uint8_t*>(data);
+#endif
+	if (!file->Data)
+	{
+		LogError("Failed to map ", path);
+		return nullptr;
+	}
+	return file;
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+	if (Data)
+		UnmapViewOfFile(Data);
+	if (Mapping)
+		CloseHandle(Mapping);
+	if (File)
+		CloseHandle(File);
+#else
+	if (Data)
+		munmap(const_cast<uint8_t*>(Data), Size);
+#endif
+}
+
+std::unique_ptr<FileSource> FileSource::Open(std::string const& path, uint32_t width, uint32_t height)
+{
+	std::unique_ptr<FileSource> source(new FileSource());
+	source->File = MappedFile::Open(path);
+	if (!source->File)
+		return nullptr;
+	if (std::filesystem::path(path).extension() == ".y4m")
+	{
+		if (!source->ParseY4M())
+		{
+			LogError("Unsupported or corrupt Y4M file: ", path);
+			return nullptr;
+		}
+	}
+	else
+	{
+		if (!width || !height)
+		{
+			LogError("Raw source ", path, " needs --source-size");
+			return nullptr;
+		}
+		source->Width = width;
+		source->Height = height;
+		source->FrameSize = size_t(width) * height * 4;
+		for (size_t offset = 0; offset + source->FrameSize <= source->File->Size; offset += source->FrameSize)
+			source->FrameOffsets.push_back(offset);
+	}
+	if (source->FrameOffsets.empty())
+	{
+		LogError("No complete frames in ", path);
+		return nullptr;
+	}
+	LogInfo("Source ", path, ": ", source->Width, "x", source->Height, ", ", source->FrameOffsets.size(), " frames");
+	return source;
+}
+
+FileSource::~FileSource()
+{
+	if (Slots[0].Buffer)
+		LogWarning("File source destroyed without Close, buffers are leaked");
+}
+
+bool FileSource::ParseY4M()
+{
+	std::string_view data(reinterpret_cast<const char*>(File->Data), File->Size);
+	auto headerEnd = data.find('\n');
+	if (!data.starts_with("YUV4MPEG2 ") || headerEnd == std::string_view::npos)
+		return false;
+	std::string_view header = data.substr(0, headerEnd);
+	// 4:2:0 is the default when the header has no colorspace
+	FrameLayout = Layout::YUV420;
+	while (!header.empty())
+	{
+		auto space = header.find(' ');
+		auto param = header.substr(0, space);
+		header = space == std::string_view::npos ? std::string_view() : header.substr(space + 1);
+		if (param.empty())
+			continue;
+		auto value = param.substr(1);
+		auto parseNumber = [&](uint32_t& out) { std::from_chars(value.data(), value.data() + value.size(), out); };
+		switch (param[0])
+		{
+		case 'W': parseNumber(Width); break;
+		case 'H': parseNumber(Height); break;
+		case 'C':
+			if (value == "444")
+				FrameLayout = Layout::YUV444;
+			else if (value.starts_with("420"))
+				FrameLayout = Layout::YUV420;
+			else
+			{
+				LogError("Y4M colorspace ", value, " is not supported, use 444 or 420");
+				return false;
+			}
+			break;
+		}
+	}
+	if (!Width || !Height || (FrameLayout == Layout::YUV420 && (Width % 2 || Height % 2)))
+		return false;
+	size_t pixelCount = size_t(Width) * Height;
+	FrameSize = FrameLayout == Layout::YUV444 ? pixelCount * 3 : pixelCount + pixelCount / 2;
+	for (size_t pos = headerEnd + 1; pos < data.size();)
+	{
+		auto frameHeaderEnd = data.find('\n', pos);
+		if (data.substr(pos, 5) != "FRAME" || frameHeaderEnd == std::string_view::npos || frameHeaderEnd + 1 + FrameSize > data.size())
+			break;
+		FrameOffsets.push_back(frameHeaderEnd + 1);
+		pos = frameHeaderEnd + 1 + FrameSize;
+	}
+	return true;
+}
+
+void FileSource::FillFrame(uint8_t* rgba, const uint8_t* frame) const
+{
+	if (FrameLayout == Layout::RGBA)
+	{
+		std::memcpy(rgba, frame, FrameSize);
+		return;
+	}
+	// BT.709 limited range, inverse of what the recorder writes
+	size_t pixelCount = size_t(Width) * Height;
+	const uint8_t* yPlane = frame;
+	const uint8_t* uPlane = yPlane + pixelCount;
+	bool is420 = FrameLayout == Layout::YUV420;
+	const uint8_t* vPlane = uPlane + (is420 ? pixelCount / 4 : pixelCount);
+	uint32_t chromaWidth = is420 ? Width / 2 : Width;
+	auto clamp = [](int v) { return uint8_t(std::clamp(v, 0, 255)); };
+	for (uint32_t row = 0; row < Height; ++row)
+	{
+		size_t chromaRow = size_t(is420 ? row / 2 : row) * chromaWidth;
+		for (uint32_t col = 0; col < Width; ++col, rgba += 4)
+		{
+			size_t chroma = chromaRow + (is420 ? col / 2 : col);
+			int c = 298 * (yPlane[size_t(row) * Width + col] - 16);
+			int d = uPlane[chroma] - 128;
+			int e = vPlane[chroma] - 128;
+			rgba[0] = clamp((c + 459 * e + 128) >> 8);
+			rgba[1] = clamp((c - 55 * d - 136 * e + 128) >> 8);
+			rgba[2] = clamp((c + 541 * d + 128) >> 8);
+			rgba[3] = 255;
+		}
+	}
+}
+
+const uint8_t* FileSource::GetFrame(size_t index, std::vector<uint8_t>& scratch) const
+{
+	const uint8_t* frame = File->Data + FrameOffsets[index];
+	if (FrameLayout == Layout::RGBA)
+		return frame;
+	scratch.resize(size_t(Width) * Height * 4);
+	FillFrame(scratch.data(), frame);
+	return scratch.data();
+}
+
+void FileSource::Upload(std::span<const GLuint> textures)
+{
+	size_t uploadSize = size_t(Width) * Height * 4;
+	if (!Slots[0].Buffer)
+	{
+		for (auto& slot : Slots)
+		{
+			glCreateBuffers(1, &slot.Buffer);
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glNamedBufferStorage(slot.Buffer, uploadSize, nullptr, flags);
+			slot.Mapped = static_cast<uint8_t*>(glMapNamedBufferRange(slot.Buffer, 0, uploadSize, flags));
+		}
+	}
+	auto& slot = Slots[NextSlot];
+	NextSlot = (NextSlot + 1) % RingSize;
+	if (!slot.Mapped)
+		return;
+	// Uploaded RingSize frames ago, so this practically never blocks
+	if (slot.Fence)
+	{
+		glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(slot.Fence);
+	}
+	FillFrame(slot.Mapped, File->Data + FrameOffsets[NextFrame]);
+	NextFrame = (NextFrame + 1) % FrameOffsets.size();
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.Buffer);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (auto texture : textures)
+		glTextureSubImage2D(texture, 0, 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FileSource::Close()
+{
+	for (auto& slot : Slots)
+	{
+		if (slot.Fence)
+			glDeleteSync(slot.Fence);
+		if (slot.Buffer)
+		{
+			if (slot.Mapped)
+				glUnmapNamedBuffer(slot.Buffer);
+			glDeleteBuffers(1, &slot.Buffer);
+		}
+		slot = {};
+	}
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Read-only view of a whole file, pages are loaded on demand by the OS
+struct MappedFile
+{
+	static std::unique_ptr<MappedFile> Open(std::string const& path);
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+	~MappedFile();
+
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+
+private:
+	MappedFile() = default;
+#if defined(_WIN32)
+	void* File = nullptr;
+	void* Mapping = nullptr;
+#endif
+};
+
+// Plays an image sequence recorded with --record (or any raw RGBA8 / 8-bit 4:4:4 or 4:2:0 Y4M file) into input textures.
+// Frames are copied from the mapped file into a ring of persistently mapped pixel buffers and uploaded from there,
+// so the copy to the GPU is asynchronous. The sequence loops.
+struct FileSource
+{
+	// width and height are only used for raw files, Y4M files carry their own size
+	static std::unique_ptr<FileSource> Open(std::string const& path, uint32_t width, uint32_t height);
+	FileSource(FileSource const&) = delete;
+	FileSource& operator=(FileSource const&) = delete;
+	~FileSource();
+
+	uint32_t GetWidth() const { return Width; }
+	uint32_t GetHeight() const { return Height; }
+	size_t GetFrameCount() const { return FrameOffsets.size(); }
+	// Returns frame index as RGBA8, pointing into the mapped file for raw files and into scratch otherwise
+	const uint8_t* GetFrame(size_t index, std::vector<uint8_t>& scratch) const;
+
+	// Uploads the next frame into every texture, call with a context current on the rendering thread
+	void Upload(std::span<const GLuint> textures);
+	// Releases the buffers, call on the uploading thread
+	void Close();
+
+private:
+	enum class Layout
+	{
+		RGBA,
+		YUV444,
+		YUV420,
+	};
+	FileSource() = default;
+	bool ParseY4M();
+	void FillFrame(uint8_t* rgba, const uint8_t* frame) const;
+
+	static constexpr size_t RingSize = 3;
+	struct Slot
+	{
+		GLuint Buffer = 0;
+		uint8_t* Mapped = nullptr;
+		GLsync Fence = nullptr;
+	};
+
+	std::unique_ptr<MappedFile> File;
+	Layout FrameLayout = Layout::RGBA;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	size_t FrameSize = 0;
+	std::vector<size_t> FrameOffsets;
+	size_t NextFrame = 0;
+	std::array<Slot, RingSize> Slots;
+	size_t NextSlot = 0;
+};
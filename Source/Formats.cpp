@@ -0,0 +1,177 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Formats.h"
+
+#include <span>
+
+using vkFormat = nos::sys::vulkan::Format;
+
+struct FormatEntry
+{
+	vkFormat Format;
+	FormatInfo Info;
+};
+
+static constexpr std::array<GLint, 4> BGRA = { GL_BLUE, GL_GREEN, GL_RED, GL_ALPHA };
+
+static constexpr FormatInfo Norm(GLenum format, uint8_t bytes, std::array<GLint, 4> swizzle = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA })
+{
+	return { .InternalFormat = format, .Swizzle = swizzle, .BytesPerPixel = bytes };
+}
+
+static constexpr FormatInfo SRGB(GLenum format, uint8_t bytes, std::array<GLint, 4> swizzle = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA })
+{
+	return { .InternalFormat = format, .Swizzle = swizzle, .BytesPerPixel = bytes, .IsSRGB = true };
+}
+
+static constexpr FormatInfo EmulatedSRGB(GLenum unormFormat, uint8_t bytes)
+{
+	return { .InternalFormat = unormFormat, .BytesPerPixel = bytes, .IsSRGB = true, .EmulatesSRGB = true };
+}
+
+static constexpr FormatInfo Int(GLenum format, uint8_t bytes, ChannelType type, uint32_t max, std::array<GLint, 4> swizzle = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA })
+{
+	return { .InternalFormat = format, .Swizzle = swizzle, .BytesPerPixel = bytes, .Type = type, .IntegerMax = max };
+}
+
+static constexpr FormatInfo Depth(GLenum format, uint8_t bytes)
+{
+	return { .InternalFormat = format, .BytesPerPixel = bytes, .IsDepth = true };
+}
+
+static constexpr FormatInfo Packed(PixelPacking packing)
+{
+	// Bytes of one pixel, a texel holds a macropixel of two
+	return { .InternalFormat = GL_RGBA8, .BytesPerPixel = 2, .Packing = packing };
+}
+
+static constexpr auto U = ChannelType::UInt;
+static constexpr auto S = ChannelType::SInt;
+
+// Formats GL has no exact match for are imported as the closest layout-compatible one:
+// SNORM and SSCALED A2R10G10B10 as unsigned, USCALED/SSCALED as integer, R8/R8G8 SRGB as UNORM with emulated conversion
+static constexpr FormatEntry FormatEntries[] = {
+	{ vkFormat::R8_UNORM, Norm(GL_R8, 1) },
+	{ vkFormat::R8_UINT, Int(GL_R8UI, 1, U, 0xFF) },
+	{ vkFormat::R8_SRGB, EmulatedSRGB(GL_R8, 1) },
+	{ vkFormat::R8G8_UNORM, Norm(GL_RG8, 2) },
+	{ vkFormat::R8G8_UINT, Int(GL_RG8UI, 2, U, 0xFF) },
+	{ vkFormat::R8G8_SRGB, EmulatedSRGB(GL_RG8, 2) },
+	{ vkFormat::R8G8B8_UNORM, Norm(GL_RGB8, 3) },
+	{ vkFormat::R8G8B8_SRGB, SRGB(GL_SRGB8, 3) },
+	{ vkFormat::B8G8R8_UNORM, Norm(GL_RGB8, 3, BGRA) },
+	{ vkFormat::B8G8R8_UINT, Int(GL_RGB8UI, 3, U, 0xFF, BGRA) },
+	{ vkFormat::B8G8R8_SRGB, SRGB(GL_SRGB8, 3, BGRA) },
+	{ vkFormat::R8G8B8A8_UNORM, Norm(GL_RGBA8, 4) },
+	{ vkFormat::R8G8B8A8_UINT, Int(GL_RGBA8UI, 4, U, 0xFF) },
+	{ vkFormat::R8G8B8A8_SRGB, SRGB(GL_SRGB8_ALPHA8, 4) },
+	{ vkFormat::B8G8R8A8_UNORM, Norm(GL_RGBA8, 4, BGRA) },
+	{ vkFormat::B8G8R8A8_SRGB, SRGB(GL_SRGB8_ALPHA8, 4, BGRA) },
+	// Vulkan packs B in the low bits, GL packs R there
+	{ vkFormat::A2R10G10B10_UNORM_PACK32, Norm(GL_RGB10_A2, 4, BGRA) },
+	{ vkFormat::A2R10G10B10_SNORM_PACK32, Norm(GL_RGB10_A2, 4, BGRA) },
+	{ vkFormat::A2R10G10B10_USCALED_PACK32, Int(GL_RGB10_A2UI, 4, U, 0x3FF, BGRA) },
+	{ vkFormat::A2R10G10B10_SSCALED_PACK32, Int(GL_RGB10_A2UI, 4, U, 0x3FF, BGRA) },
+	{ vkFormat::A2R10G10B10_UINT_PACK32, Int(GL_RGB10_A2UI, 4, U, 0x3FF, BGRA) },
+	{ vkFormat::A2R10G10B10_SINT_PACK32, Int(GL_RGB10_A2UI, 4, U, 0x3FF, BGRA) },
+	{ vkFormat::R16_UNORM, Norm(GL_R16, 2) },
+	{ vkFormat::R16_SNORM, Norm(GL_R16_SNORM, 2) },
+	{ vkFormat::R16_USCALED, Int(GL_R16UI, 2, U, 0xFFFF) },
+	{ vkFormat::R16_SSCALED, Int(GL_R16I, 2, S, 0x7FFF) },
+	{ vkFormat::R16_UINT, Int(GL_R16UI, 2, U, 0xFFFF) },
+	{ vkFormat::R16_SINT, Int(GL_R16I, 2, S, 0x7FFF) },
+	{ vkFormat::R16_SFLOAT, Norm(GL_R16F, 2) },
+	{ vkFormat::R16G16_UNORM, Norm(GL_RG16, 4) },
+	{ vkFormat::R16G16_SNORM, Norm(GL_RG16_SNORM, 4) },
+	{ vkFormat::R16G16_USCALED, Int(GL_RG16UI, 4, U, 0xFFFF) },
+	{ vkFormat::R16G16_SSCALED, Int(GL_RG16I, 4, S, 0x7FFF) },
+	{ vkFormat::R16G16_UINT, Int(GL_RG16UI, 4, U, 0xFFFF) },
+	{ vkFormat::R16G16_SINT, Int(GL_RG16I, 4, S, 0x7FFF) },
+	{ vkFormat::R16G16_SFLOAT, Norm(GL_RG16F, 4) },
+	{ vkFormat::R16G16B16_UNORM, Norm(GL_RGB16, 6) },
+	{ vkFormat::R16G16B16_SNORM, Norm(GL_RGB16_SNORM, 6) },
+	{ vkFormat::R16G16B16_USCALED, Int(GL_RGB16UI, 6, U, 0xFFFF) },
+	{ vkFormat::R16G16B16_SSCALED, Int(GL_RGB16I, 6, S, 0x7FFF) },
+	{ vkFormat::R16G16B16_UINT, Int(GL_RGB16UI, 6, U, 0xFFFF) },
+	{ vkFormat::R16G16B16_SINT, Int(GL_RGB16I, 6, S, 0x7FFF) },
+	{ vkFormat::R16G16B16_SFLOAT, Norm(GL_RGB16F, 6) },
+	{ vkFormat::R16G16B16A16_UNORM, Norm(GL_RGBA16, 8) },
+	{ vkFormat::R16G16B16A16_SNORM, Norm(GL_RGBA16_SNORM, 8) },
+	{ vkFormat::R16G16B16A16_USCALED, Int(GL_RGBA16UI, 8, U, 0xFFFF) },
+	{ vkFormat::R16G16B16A16_SSCALED, Int(GL_RGBA16I, 8, S, 0x7FFF) },
+	{ vkFormat::R16G16B16A16_UINT, Int(GL_RGBA16UI, 8, U, 0xFFFF) },
+	{ vkFormat::R16G16B16A16_SINT, Int(GL_RGBA16I, 8, S, 0x7FFF) },
+	{ vkFormat::R16G16B16A16_SFLOAT, Norm(GL_RGBA16F, 8) },
+	{ vkFormat::R32_UINT, Int(GL_R32UI, 4, U, 0xFFFFFFFF) },
+	{ vkFormat::R32_SINT, Int(GL_R32I, 4, S, 0x7FFFFFFF) },
+	{ vkFormat::R32_SFLOAT, Norm(GL_R32F, 4) },
+	{ vkFormat::R32G32_UINT, Int(GL_RG32UI, 8, U, 0xFFFFFFFF) },
+	{ vkFormat::R32G32_SINT, Int(GL_RG32I, 8, S, 0x7FFFFFFF) },
+	{ vkFormat::R32G32_SFLOAT, Norm(GL_RG32F, 8) },
+	{ vkFormat::R32G32B32_UINT, Int(GL_RGB32UI, 12, U, 0xFFFFFFFF) },
+	{ vkFormat::R32G32B32_SINT, Int(GL_RGB32I, 12, S, 0x7FFFFFFF) },
+	{ vkFormat::R32G32B32_SFLOAT, Norm(GL_RGB32F, 12) },
+	{ vkFormat::R32G32B32A32_UINT, Int(GL_RGBA32UI, 16, U, 0xFFFFFFFF) },
+	{ vkFormat::R32G32B32A32_SINT, Int(GL_RGBA32I, 16, S, 0x7FFFFFFF) },
+	{ vkFormat::R32G32B32A32_SFLOAT, Norm(GL_RGBA32F, 16) },
+	// Same bit layout in both APIs
+	{ vkFormat::B10G11R11_UFLOAT_PACK32, Norm(GL_R11F_G11F_B10F, 4) },
+	{ vkFormat::D16_UNORM, Depth(GL_DEPTH_COMPONENT16, 2) },
+	{ vkFormat::X8_D24_UNORM_PACK32, Depth(GL_DEPTH_COMPONENT24, 4) },
+	{ vkFormat::D32_SFLOAT, Depth(GL_DEPTH_COMPONENT32F, 4) },
+	// Macropixels of two pixels, imported at half width and unpacked in shaders
+	{ vkFormat::G8B8G8R8_422_UNORM, Packed(PixelPacking::YUYV422) },
+	{ vkFormat::B8G8R8G8_422_UNORM, Packed(PixelPacking::UYVY422) },
+};
+
+// Core formats are numbered densely from 0, extension formats (e.g. 4:2:2) start at 1000000000
+static constexpr uint32_t CoreFormatCount = 256;
+
+static constexpr auto CoreFormats = [] {
+	std::array<FormatInfo, CoreFormatCount> table{};
+	for (auto& entry : FormatEntries)
+		if (uint32_t(entry.Format) < CoreFormatCount)
+			table[uint32_t(entry.Format)] = entry.Info;
+	return table;
+}();
+
+static constexpr FormatInfo UnknownFormat{};
+
+static constexpr FormatInfo const& LookUp(vkFormat format)
+{
+	if (uint32_t(format) < CoreFormatCount)
+		return CoreFormats[uint32_t(format)];
+	// Only a handful of extension formats, all at the end of the table
+	for (auto& entry : std::span(FormatEntries).last(2))
+		if (entry.Format == format)
+			return entry.Info;
+	return UnknownFormat;
+}
+
+static_assert(LookUp(vkFormat::B8G8R8A8_UNORM).HasSwizzle());
+static_assert(!LookUp(vkFormat::R8G8B8A8_SRGB).HasSwizzle() && LookUp(vkFormat::R8G8B8A8_SRGB).IsSRGB);
+static_assert(LookUp(vkFormat::R16G16B16A16_UINT).IsInteger());
+static_assert(LookUp(vkFormat::B8G8R8G8_422_UNORM).Packing == PixelPacking::UYVY422);
+static_assert(LookUp(vkFormat::R8_SRGB).InternalFormat == GL_R8 && LookUp(vkFormat::R8_SRGB).EmulatesSRGB);
+static_assert(LookUp(vkFormat::UNDEFINED).InternalFormat == GL_NONE);
+
+FormatInfo const& GetFormatInfo(nos::sys::vulkan::Format format)
+{
+	return LookUp(format);
+}
+
+void ApplyFormatSwizzle(GLuint texture, FormatInfo const& info)
+{
+	if (info.HasSwizzle())
+		glTextureParameteriv(texture, GL_TEXTURE_SWIZZLE_RGBA, info.Swizzle.data());
+}
+
+std::string GetSwizzleSuffix(FormatInfo const& info)
+{
+	std::string suffix;
+	for (auto channel : info.Swizzle)
+		suffix += channel == GL_RED ? 'r' : channel == GL_GREEN ? 'g' : channel == GL_BLUE ? 'b' : 'a';
+	return suffix;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "nosVulkanSubsystem/nosVulkanSubsystem.h"
+
+// 4:2:2 textures are imported at half width as RGBA8, each texel holding a macropixel of two pixels
+enum class PixelPacking
+{
+	None,
+	// G8B8G8R8_422_UNORM: Y0, Cb, Y1, Cr
+	YUYV422,
+	// B8G8R8G8_422_UNORM: Cb, Y0, Cr, Y1
+	UYVY422,
+};
+
+// How shaders see a format's channels
+enum class ChannelType : uint8_t
+{
+	// UNORM, SNORM and SFLOAT, read and written as vec4
+	Float,
+	UInt,
+	SInt,
+};
+
+// Everything the app needs to know about a Vulkan format to import, sample and render to it
+struct FormatInfo
+{
+	GLenum InternalFormat = GL_NONE;
+	// Maps the GL channels of the imported texture back to Vulkan's component order, identity for RGBA-ordered formats.
+	// Every swizzle in the table swaps at most R and B, so the same mapping reorders colors written to the texture.
+	std::array<GLint, 4> Swizzle = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+	uint8_t BytesPerPixel = 0;
+	ChannelType Type = ChannelType::Float;
+	// Largest channel value of integer formats, shaders divide by it to get normalized colors
+	uint32_t IntegerMax = 0;
+	bool IsSRGB = false;
+	// sRGB formats GL has no internal format for, imported as UNORM with the conversion done in shaders
+	bool EmulatesSRGB = false;
+	bool IsDepth = false;
+	PixelPacking Packing = PixelPacking::None;
+
+	constexpr bool IsInteger() const { return Type != ChannelType::Float; }
+	constexpr bool HasSwizzle() const { return Swizzle[0] != GL_RED || Swizzle[2] != GL_BLUE; }
+};
+
+// Layout of a texture beyond the 2D size and format carried by the pin's descriptor
+struct TextureShape
+{
+	// GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_3D
+	GLenum Target = GL_TEXTURE_2D;
+	// Mip levels, all allocated by Nodos in the same memory
+	uint32_t Levels = 1;
+	// Array layers or depth slices
+	uint32_t Depth = 1;
+};
+
+// O(1), formats that are not in the table have InternalFormat GL_NONE
+FormatInfo const& GetFormatInfo(nos::sys::vulkan::Format format);
+
+// Applies info.Swizzle to a texture created with info.InternalFormat
+void ApplyFormatSwizzle(GLuint texture, FormatInfo const& info);
+
+// GLSL swizzle suffix (e.g. "bgra") reordering colors for a render target of this format
+std::string GetSwizzleSuffix(FormatInfo const& info);
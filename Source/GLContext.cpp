@@ -0,0 +1,56 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "GLContext.h"
+
+#include "Log.h"
+
+static void APIENTRY debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user_param)
+{
+	LogSeverity logSeverity;
+	switch (severity)
+	{
+	case GL_DEBUG_SEVERITY_HIGH:
+		logSeverity = LogSeverity::Error;
+		break;
+	case GL_DEBUG_SEVERITY_MEDIUM:
+		logSeverity = LogSeverity::Warning;
+		break;
+	case GL_DEBUG_SEVERITY_LOW:
+		logSeverity = LogSeverity::Info;
+		break;
+	default:
+	case GL_DEBUG_SEVERITY_NOTIFICATION:
+		logSeverity = LogSeverity::Debug;
+		break;
+	}
+	// Rate limited per message rather than per call site, so one flooding message doesn't hide the others
+	uint64_t key = (uint64_t(source) << 48) ^ (uint64_t(type) << 32) ^ id;
+	LogWithKey(logSeverity, key, "OpenGL: ", length < 0 ? std::string_view(message) : std::string_view(message, length));
+}
+
+GLFWwindow* CreateSharedContext(GLFWwindow* share)
+{
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* context = glfwCreateWindow(1, 1, "OpenGLAppSample Worker", nullptr, share);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!context)
+		LogError("Failed to create shared GL context");
+	return context;
+}
+
+void EnableDebugOutput()
+{
+	glEnable(GL_DEBUG_OUTPUT);
+	glDebugMessageCallback(debug_message_callback, nullptr);
+	// Filtered notifications are not even generated
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, IsLogged(LogSeverity::Debug));
+}
+
+bool IsWindowHidden(GLFWwindow* window)
+{
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	return glfwGetWindowAttrib(window, GLFW_ICONIFIED) || !glfwGetWindowAttrib(window, GLFW_VISIBLE) || width == 0 || height == 0;
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// Creates a hidden window whose context shares textures, buffers, programs and sync objects with share.
+// Must be called on the main thread, the context can then be made current on any one thread.
+GLFWwindow* CreateSharedContext(GLFWwindow* share);
+
+// Debug output is per context, call once after making a context current
+void EnableDebugOutput();
+
+// Iconified, hidden or without a framebuffer. GLFW can't tell whether a visible window is covered by others.
+bool IsWindowHidden(GLFWwindow* window);
@@ -0,0 +1,135 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "GLState.h"
+
+template <typename T>
+bool GLStateCache::Update(T& cached, T value)
+{
+	if (cached == value)
+	{
+		Elided++;
+		return false;
+	}
+	cached = value;
+	Issued++;
+	return true;
+}
+
+void GLStateCache::BindFramebuffer(GLuint fbo)
+{
+	if (!Update(Framebuffer, fbo))
+		return;
+	IssuedBinds.Framebuffer++;
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (Update(ViewportRect, { x, y, width, height }))
+		glViewport(x, y, width, height);
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+	if (!Update(Program, program))
+		return;
+	IssuedBinds.Program++;
+	glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(GLuint vao)
+{
+	if (!Update(VertexArray, vao))
+		return;
+	IssuedBinds.VertexArray++;
+	glBindVertexArray(vao);
+}
+
+void GLStateCache::BindTextureUnit(GLuint unit, GLuint texture)
+{
+	if (unit >= MaxUnits)
+	{
+		Issued++;
+		glBindTextureUnit(unit, texture);
+		return;
+	}
+	if (Update(Textures[unit], texture))
+		glBindTextureUnit(unit, texture);
+}
+
+void GLStateCache::BindImageTexture(GLuint unit, GLuint texture, GLenum format)
+{
+	// The format is part of the binding, compare both without counting the call twice
+	bool changed = unit >= MaxUnits || Images[unit] != texture || ImageFormats[unit] != format;
+	if (!changed)
+	{
+		Elided++;
+		return;
+	}
+	if (unit < MaxUnits)
+	{
+		Images[unit] = texture;
+		ImageFormats[unit] = format;
+	}
+	Issued++;
+	glBindImageTexture(unit, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+}
+
+void GLStateCache::BindStorageBuffers(GLuint first, std::span<GLuint const> buffers)
+{
+	if (buffers.empty())
+		return;
+	bool changed = first + buffers.size() > MaxUnits;
+	for (size_t i = 0; i < buffers.size() && !changed; ++i)
+		changed = StorageBuffers[first + i] != buffers[i];
+	if (!changed)
+	{
+		Elided++;
+		return;
+	}
+	for (size_t i = 0; i < buffers.size() && first + i < MaxUnits; ++i)
+		StorageBuffers[first + i] = buffers[i];
+	Issued++;
+	glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, first, GLsizei(buffers.size()), buffers.data());
+}
+
+void GLStateCache::ClipControl(GLenum origin, GLenum depth)
+{
+	bool changed = ClipOrigin != origin || ClipDepth != depth;
+	if (!changed)
+	{
+		Elided++;
+		return;
+	}
+	ClipOrigin = origin;
+	ClipDepth = depth;
+	Issued++;
+	glClipControl(origin, depth);
+}
+
+void GLStateCache::InvalidateBindings()
+{
+	Framebuffer = Unknown;
+	Program = Unknown;
+	VertexArray = Unknown;
+	Textures.fill(Unknown);
+	Images.fill(Unknown);
+	ImageFormats.fill(GL_NONE);
+	StorageBuffers.fill(Unknown);
+}
+
+void GLStateCache::Invalidate()
+{
+	InvalidateBindings();
+	ViewportRect = { -1, -1, -1, -1 };
+	ClipOrigin = GL_NONE;
+	ClipDepth = GL_NONE;
+}
+
+GLStateCache& GetGLState()
+{
+	thread_local GLStateCache cache;
+	return cache;
+}
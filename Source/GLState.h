@@ -0,0 +1,74 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include <glad/glad.h>
+
+// Framebuffer, program and vertex array binds, the ones a steady-state frame should mostly elide
+struct GLBindCounts
+{
+	uint64_t Framebuffer = 0;
+	uint64_t Program = 0;
+	uint64_t VertexArray = 0;
+};
+
+// Tracks the bindings and fixed-function state of the current context and skips calls that would not change them.
+// Every thread in this app keeps one context current for its lifetime, so there is one cache per thread.
+// Deleting a bound object silently unbinds it and its name may be reused, so call InvalidateBindings after deleting
+// anything the cache may have seen bound, and Invalidate after changing tracked state without going through it.
+class GLStateCache
+{
+public:
+	GLStateCache() { InvalidateBindings(); }
+
+	void BindFramebuffer(GLuint fbo);
+	void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vao);
+	void BindTextureUnit(GLuint unit, GLuint texture);
+	// Level 0, not layered, write-only
+	void BindImageTexture(GLuint unit, GLuint texture, GLenum format);
+	// Binding points first..first + buffers.size() - 1, bound with one call if any of them changed
+	void BindStorageBuffers(GLuint first, std::span<GLuint const> buffers);
+	void ClipControl(GLenum origin, GLenum depth);
+
+	void InvalidateBindings();
+	void Invalidate();
+
+	uint64_t GetIssuedCount() const { return Issued; }
+	uint64_t GetElidedCount() const { return Elided; }
+	// Issued binds, counted with the other issued calls as well
+	GLBindCounts const& GetIssuedBinds() const { return IssuedBinds; }
+
+private:
+	// Records a call, returns true if it has to be issued
+	template <typename T>
+	bool Update(T& cached, T value);
+
+	static constexpr size_t MaxUnits = 32;
+	static constexpr GLuint Unknown = ~0u;
+
+	GLuint Framebuffer = Unknown;
+	std::array<GLint, 4> ViewportRect = { -1, -1, -1, -1 };
+	GLuint Program = Unknown;
+	GLuint VertexArray = Unknown;
+	std::array<GLuint, MaxUnits> Textures;
+	std::array<GLuint, MaxUnits> Images;
+	std::array<GLenum, MaxUnits> ImageFormats;
+	std::array<GLuint, MaxUnits> StorageBuffers;
+	GLenum ClipOrigin = GL_NONE;
+	GLenum ClipDepth = GL_NONE;
+
+	uint64_t Issued = 0;
+	uint64_t Elided = 0;
+	GLBindCounts IssuedBinds;
+};
+
+// The cache of the context current on this thread
+GLStateCache& GetGLState();
@@ -0,0 +1,68 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Golden.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <limits>
+
+// Failures after this many are only counted
+static constexpr uint64_t MaxReportedFailures = 10;
+
+std::unique_ptr<GoldenComparator> GoldenComparator::Open(std::string const& path, uint32_t width, uint32_t height, uint32_t tolerance)
+{
+	auto reference = FileSource::Open(path, width, height);
+	if (!reference)
+		return nullptr;
+	auto comparator = std::make_unique<GoldenComparator>();
+	comparator->Reference = std::move(reference);
+	comparator->Tolerance = tolerance;
+	comparator->WorstPSNR = std::numeric_limits<double>::infinity();
+	return comparator;
+}
+
+bool GoldenComparator::Compare(const uint8_t* rgba, uint32_t width, uint32_t height, uint64_t frameNumber)
+{
+	auto fail = [&](auto&&... message)
+		{
+			if (++Failed <= MaxReportedFailures)
+			{
+				std::cerr << "Golden frame " << frameNumber << ": ";
+				(std::cerr << ... << message) << std::endl;
+			}
+			return false;
+		};
+	if (width != Reference->GetWidth() || height != Reference->GetHeight())
+		return fail("size ", width, "x", height, " doesn't match the reference");
+	if (frameNumber >= Reference->GetFrameCount())
+		return fail("no reference frame");
+
+	const uint8_t* reference = Reference->GetFrame(frameNumber, Scratch);
+	auto start = std::chrono::steady_clock::now();
+	auto diff = CompareImages(rgba, reference, size_t(width) * height * 4);
+	CompareSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	Compared++;
+	Total.Accumulate(diff);
+	WorstPSNR = std::min(WorstPSNR, diff.GetPSNR());
+	if (diff.MaxError > Tolerance)
+		return fail("max error ", int(diff.MaxError), ", PSNR ", diff.GetPSNR(), " dB");
+	return true;
+}
+
+bool GoldenComparator::Report(uint32_t instanceIndex, uint64_t expectedFrames) const
+{
+	bool passed = Failed == 0 && Compared > 0 && Compared == expectedFrames;
+	// Both images are read
+	double bytes = double(Total.SampleCount) * 2;
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Instance " << instanceIndex << " golden: " << (passed ? "PASSED" : "FAILED")
+		<< ", compared " << Compared << "/" << expectedFrames << " frames, failed " << Failed
+		<< ", max error " << int(Total.MaxError) << " (tolerance " << Tolerance << ")"
+		<< ", overall PSNR " << Total.GetPSNR() << " dB, worst frame " << WorstPSNR << " dB"
+		<< ", compare " << GetCompareImplementation() << " " << (CompareSeconds > 0 ? bytes / CompareSeconds / 1e9 : 0) << " GB/s" << std::endl;
+	return passed;
+}
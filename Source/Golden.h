@@ -0,0 +1,35 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileSource.h"
+#include "ImageCompare.h"
+
+// Compares rendered frames against a reference sequence recorded earlier with --record.
+// Frame N of the render is compared with frame N of the reference, every channel including alpha.
+struct GoldenComparator
+{
+	// width and height are only used for raw references
+	static std::unique_ptr<GoldenComparator> Open(std::string const& path, uint32_t width, uint32_t height, uint32_t tolerance);
+
+	// Called from the recorder's writer thread, returns false if the frame is outside the tolerance
+	bool Compare(const uint8_t* rgba, uint32_t width, uint32_t height, uint64_t frameNumber);
+	// Prints the results, call after the recorder is closed. Returns true if expectedFrames frames were compared and all passed.
+	bool Report(uint32_t instanceIndex, uint64_t expectedFrames) const;
+
+private:
+	std::unique_ptr<FileSource> Reference;
+	uint32_t Tolerance = 0;
+	std::vector<uint8_t> Scratch;
+	uint64_t Compared = 0;
+	uint64_t Failed = 0;
+	ImageDiff Total;
+	double WorstPSNR = 0;
+	double CompareSeconds = 0;
+};
@@ -0,0 +1,167 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "ImageCompare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define IMAGE_COMPARE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+double ImageDiff::GetPSNR() const
+{
+	if (SquaredError == 0 || SampleCount == 0)
+		return std::numeric_limits<double>::infinity();
+	double mse = double(SquaredError) / double(SampleCount);
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void ImageDiff::Accumulate(ImageDiff const& other)
+{
+	MaxError = std::max(MaxError, other.MaxError);
+	SquaredError += other.SquaredError;
+	SampleCount += other.SampleCount;
+}
+
+static ImageDiff CompareScalar(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	ImageDiff diff{ .SampleCount = size };
+	for (size_t i = 0; i < size; ++i)
+	{
+		int d = std::abs(int(a[i]) - int(b[i]));
+		diff.MaxError = std::max(diff.MaxError, uint8_t(d));
+		diff.SquaredError += uint64_t(d * d);
+	}
+	return diff;
+}
+
+#if IMAGE_COMPARE_X86
+// Squared differences are summed in 32-bit lanes, each iteration adds at most 4 * 255^2 per lane,
+// so the lanes are widened to 64 bits before they can overflow
+static constexpr size_t BlockIterations = 4096;
+
+static ImageDiff CompareSSE2(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i maxError = zero;
+	__m128i sum64 = zero;
+	size_t i = 0;
+	while (i + 16 <= size)
+	{
+		__m128i sum32 = zero;
+		size_t blockEnd = std::min(size - size % 16, i + BlockIterations * 16);
+		for (; i < blockEnd; i += 16)
+		{
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+			__m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+			maxError = _mm_max_epu8(maxError, d);
+			__m128i lo = _mm_unpacklo_epi8(d, zero);
+			__m128i hi = _mm_unpackhi_epi8(d, zero);
+			sum32 = _mm_add_epi32(sum32, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+		}
+		sum64 = _mm_add_epi64(sum64, _mm_add_epi64(_mm_unpacklo_epi32(sum32, zero), _mm_unpackhi_epi32(sum32, zero)));
+	}
+	alignas(16) uint8_t maxLanes[16];
+	alignas(16) uint64_t sumLanes[2];
+	_mm_store_si128(reinterpret_cast<__m128i*>(maxLanes), maxError);
+	_mm_store_si128(reinterpret_cast<__m128i*>(sumLanes), sum64);
+	ImageDiff diff = CompareScalar(a + i, b + i, size - i);
+	diff.MaxError = std::max(diff.MaxError, *std::ranges::max_element(maxLanes));
+	diff.SquaredError += sumLanes[0] + sumLanes[1];
+	diff.SampleCount = size;
+	return diff;
+}
+
+TARGET_AVX2 static ImageDiff CompareAVX2(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i maxError = zero;
+	__m256i sum64 = zero;
+	size_t i = 0;
+	while (i + 32 <= size)
+	{
+		__m256i sum32 = zero;
+		size_t blockEnd = std::min(size - size % 32, i + BlockIterations * 32);
+		for (; i < blockEnd; i += 32)
+		{
+			__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+			__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+			__m256i d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+			maxError = _mm256_max_epu8(maxError, d);
+			__m256i lo = _mm256_unpacklo_epi8(d, zero);
+			__m256i hi = _mm256_unpackhi_epi8(d, zero);
+			sum32 = _mm256_add_epi32(sum32, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+		}
+		sum64 = _mm256_add_epi64(sum64, _mm256_add_epi64(_mm256_unpacklo_epi32(sum32, zero), _mm256_unpackhi_epi32(sum32, zero)));
+	}
+	alignas(32) uint8_t maxLanes[32];
+	alignas(32) uint64_t sumLanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(maxLanes), maxError);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(sumLanes), sum64);
+	ImageDiff diff = CompareScalar(a + i, b + i, size - i);
+	diff.MaxError = std::max(diff.MaxError, *std::ranges::max_element(maxLanes));
+	diff.SquaredError += sumLanes[0] + sumLanes[1] + sumLanes[2] + sumLanes[3];
+	diff.SampleCount = size;
+	return diff;
+}
+
+static bool HasAVX2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	return avx2 && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+using CompareFunction = ImageDiff(const uint8_t*, const uint8_t*, size_t);
+
+static CompareFunction* SelectCompare(const char*& name)
+{
+#if IMAGE_COMPARE_X86
+	if (HasAVX2())
+	{
+		name = "AVX2";
+		return CompareAVX2;
+	}
+	name = "SSE2";
+	return CompareSSE2;
+#else
+	name = "scalar";
+	return CompareScalar;
+#endif
+}
+
+static const char* CompareName = nullptr;
+static CompareFunction* const Compare = SelectCompare(CompareName);
+
+ImageDiff CompareImages(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	return Compare(a, b, size);
+}
+
+const char* GetCompareImplementation()
+{
+	return CompareName;
+}
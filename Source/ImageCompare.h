@@ -0,0 +1,26 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+struct ImageDiff
+{
+	// Largest absolute difference of any channel
+	uint8_t MaxError = 0;
+	// Sum of squared channel differences
+	uint64_t SquaredError = 0;
+	size_t SampleCount = 0;
+
+	// Infinite for identical images
+	double GetPSNR() const;
+	void Accumulate(ImageDiff const& other);
+};
+
+// Compares two 8-bit images byte by byte. Uses AVX2 when the CPU has it, SSE2 otherwise on x86-64.
+ImageDiff CompareImages(const uint8_t* a, const uint8_t* b, size_t size);
+// Name of the implementation CompareImages dispatches to
+const char* GetCompareImplementation();
@@ -0,0 +1,248 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Import.h"
+#include "Log.h"
+
+#include <algorithm>
+
+uint32_t GetStorageWidth(nos::sys::vulkan::TTexture const& tex)
+{
+	return GetFormatInfo(tex.format).Packing == PixelPacking::None ? tex.width : tex.width / 2;
+}
+
+static bool IsValidShape(FormatInfo const& format, TextureShape const& shape)
+{
+	if (shape.Levels == 0 || shape.Depth == 0 || (shape.Target == GL_TEXTURE_2D && shape.Depth != 1))
+	{
+		LogError("Invalid texture shape");
+		return false;
+	}
+	if (format.Packing != PixelPacking::None && (shape.Target != GL_TEXTURE_2D || shape.Levels != 1))
+	{
+		LogError("4:2:2 textures can only be imported as a single level 2D texture");
+		return false;
+	}
+	return true;
+}
+
+static void SetShapeParameters(GLuint texture, TextureShape const& shape)
+{
+	if (shape.Levels > 1)
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	if (shape.Target == GL_TEXTURE_3D)
+	{
+		// LUT volumes are sampled at their edges
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+}
+
+static std::optional<GLImportedTexture> ImportWithLayout(nos::app::IAppServiceClient* client, nos::sys::vulkan::TTexture const& tex, TextureShape const& shape,
+	FormatInfo const& format, MemoryLayout const& layout)
+{
+	GLImportedTexture imported{};
+	glCreateMemoryObjectsEXT(1, &imported.Memory);
+	TrackResource(TrackedKind::MemoryObject, imported.Memory, "texture pin");
+	if (!glIsMemoryObjectEXT(imported.Memory))
+	{
+		LogError("Failed to create memory object");
+		return std::nullopt;
+	}
+	if (glGetError() != GL_NO_ERROR)
+	{
+		LogError("Failed to create memory object");
+		return std::nullopt;
+	}
+	// Can only be set before the import
+	GLint dedicated = layout.Dedicated ? GL_TRUE : GL_FALSE;
+	glMemoryObjectParameterivEXT(imported.Memory, GL_DEDICATED_MEMORY_OBJECT_EXT, &dedicated);
+	auto handle = ImportedOSHandle(client, (NOS_HANDLE)tex.external_memory.handle(), "texture pin");
+	if(!handle.OSHandle)
+	{
+		LogError("Failed to duplicate handle");
+		return std::nullopt;
+	}
+	glImportMemory(imported.Memory, tex.external_memory.allocation_size(), GL_HANDLE_TYPE, *handle.OSHandle);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		while (glGetError() != GL_NO_ERROR) {}
+		return std::nullopt;
+	}
+	handle.ReleaseAfterImport();
+	glCreateTextures(shape.Target, 1, &imported.Image);
+	TrackResource(TrackedKind::Texture, imported.Image, "texture pin");
+	// Must match the tiling of the Vulkan image, set before the storage is bound
+	glTextureParameteri(imported.Image, GL_TEXTURE_TILING_EXT, layout.LinearTiling ? GL_LINEAR_TILING_EXT : GL_OPTIMAL_TILING_EXT);
+	if (shape.Target == GL_TEXTURE_2D)
+		glTextureStorageMem2DEXT(imported.Image, shape.Levels, format.InternalFormat, GetStorageWidth(tex), tex.height, imported.Memory, tex.offset);
+	else
+		glTextureStorageMem3DEXT(imported.Image, shape.Levels, format.InternalFormat, GetStorageWidth(tex), tex.height, shape.Depth, imported.Memory, tex.offset);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		// Don't let errors of a rejected layout fail the next attempt
+		while (glGetError() != GL_NO_ERROR) {}
+		return std::nullopt;
+	}
+	return imported;
+}
+
+// The layout derived from tex and the hints first, then the ones the hints leave open
+static std::vector<MemoryLayout> GetMemoryLayoutCandidates(nos::sys::vulkan::TTexture const& tex, MemoryImportHints const& hints)
+{
+	// Nodos exports each image as an optimally tiled allocation of its own, a non-zero offset means it was suballocated
+	MemoryLayout preferred{
+		.Dedicated = hints.Dedicated.value_or(tex.offset == 0),
+		.LinearTiling = hints.LinearTiling.value_or(false),
+	};
+	std::vector<MemoryLayout> candidates = { preferred };
+	if (!hints.Dedicated)
+		candidates.push_back({ !preferred.Dedicated, preferred.LinearTiling });
+	if (!hints.LinearTiling)
+		candidates.push_back({ preferred.Dedicated, !preferred.LinearTiling });
+	if (!hints.Dedicated && !hints.LinearTiling)
+		candidates.push_back({ !preferred.Dedicated, !preferred.LinearTiling });
+	return candidates;
+}
+
+std::optional<GLImportedTexture> ImportTexture(nos::app::IAppServiceClient* client, nos::sys::vulkan::TTexture const& tex, TextureShape const& shape, MemoryImportHints const& hints)
+{
+	auto& format = GetFormatInfo(tex.format);
+	if (format.InternalFormat == GL_NONE)
+	{
+		LogError("Unsupported texture format: ", uint32_t(tex.format));
+		return std::nullopt;
+	}
+	if (!IsValidShape(format, shape))
+		return std::nullopt;
+	auto candidates = GetMemoryLayoutCandidates(tex, hints);
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		auto& layout = candidates[i];
+		auto imported = ImportWithLayout(client, tex, shape, format, layout);
+		if (!imported)
+			continue;
+		if (i != 0)
+			LogWarning("Imported texture as ", layout.Dedicated ? "dedicated" : "suballocated", " memory with ", layout.LinearTiling ? "linear" : "optimal", " tiling after the preferred layout failed");
+		ApplyFormatSwizzle(imported->Image, format);
+		SetShapeParameters(imported->Image, shape);
+		return imported;
+	}
+	LogError("Failed to create texture");
+	return std::nullopt;
+}
+
+std::optional<GLImportedTexture> CreateStandInTexture(nos::sys::vulkan::TTexture const& tex, TextureShape const& shape)
+{
+	auto& format = GetFormatInfo(tex.format);
+	if (!IsValidShape(format, shape))
+		return std::nullopt;
+	GLenum internalFormat = format.InternalFormat == GL_NONE ? GL_RGBA8 : format.InternalFormat;
+	GLImportedTexture standIn{};
+	glCreateTextures(shape.Target, 1, &standIn.Image);
+	TrackResource(TrackedKind::Texture, standIn.Image, "stand-in texture");
+	if (shape.Target == GL_TEXTURE_2D)
+		glTextureStorage2D(standIn.Image, shape.Levels, internalFormat, GetStorageWidth(tex), tex.height);
+	else
+		glTextureStorage3D(standIn.Image, shape.Levels, internalFormat, GetStorageWidth(tex), tex.height, shape.Depth);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		LogError("Failed to create stand-in texture");
+		return std::nullopt;
+	}
+	ApplyFormatSwizzle(standIn.Image, format);
+	SetShapeParameters(standIn.Image, shape);
+	return standIn;
+}
+
+std::optional<GLImportedBuffer> ImportBuffer(nos::app::IAppServiceClient* client, nos::sys::vulkan::TBuffer const& buf)
+{
+	if (buf.size_in_bytes == 0)
+	{
+		LogError("Can't import an empty buffer");
+		return std::nullopt;
+	}
+	GLImportedBuffer imported{};
+	glCreateMemoryObjectsEXT(1, &imported.Memory);
+	TrackResource(TrackedKind::MemoryObject, imported.Memory, "buffer pin");
+	if (!glIsMemoryObjectEXT(imported.Memory) || glGetError() != GL_NO_ERROR)
+	{
+		LogError("Failed to create memory object");
+		return std::nullopt;
+	}
+	auto handle = ImportedOSHandle(client, (NOS_HANDLE)buf.external_memory.handle(), "buffer pin");
+	if (!handle.OSHandle)
+	{
+		LogError("Failed to duplicate handle");
+		return std::nullopt;
+	}
+	glImportMemory(imported.Memory, buf.external_memory.allocation_size(), GL_HANDLE_TYPE, *handle.OSHandle);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		LogError("Failed to import buffer memory");
+		return std::nullopt;
+	}
+	handle.ReleaseAfterImport();
+	glCreateBuffers(1, &imported.Buffer);
+	TrackResource(TrackedKind::Buffer, imported.Buffer, "buffer pin");
+	glNamedBufferStorageMemEXT(imported.Buffer, GLsizeiptr(buf.size_in_bytes), imported.Memory, buf.offset);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		LogError("Failed to create buffer");
+		return std::nullopt;
+	}
+	imported.Size = buf.size_in_bytes;
+	return imported;
+}
+
+std::optional<GLImportedBuffer> CreateStandInBuffer(nos::sys::vulkan::TBuffer const& buf)
+{
+	GLImportedBuffer standIn{};
+	glCreateBuffers(1, &standIn.Buffer);
+	TrackResource(TrackedKind::Buffer, standIn.Buffer, "stand-in buffer");
+	glNamedBufferStorage(standIn.Buffer, GLsizeiptr(std::max<uint64_t>(buf.size_in_bytes, 16)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		LogError("Failed to create stand-in buffer");
+		return std::nullopt;
+	}
+	standIn.Size = std::max<uint64_t>(buf.size_in_bytes, 16);
+	uint32_t zero = 0;
+	glClearNamedBufferData(standIn.Buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	return standIn;
+}
+
+std::optional<GLImportedSemaphore> ImportSemaphore(nos::app::IAppServiceClient* client, uint64_t pid, uint64_t handle)
+{
+	GLImportedSemaphore imported{};
+	glGenSemaphoresEXT(1, &imported.Semaphore);
+	TrackResource(TrackedKind::Semaphore, imported.Semaphore, "sync semaphore");
+	auto semaphoreHandle = ImportedOSHandle(client, (NOS_HANDLE)handle, "sync semaphore");
+	if (!semaphoreHandle.OSHandle)
+	{
+		LogError("Failed to duplicate handle");
+		return std::nullopt;
+	}
+	glImportSemaphore(imported.Semaphore, GL_HANDLE_TYPE, *semaphoreHandle.OSHandle);
+	if (glGetError() != GL_NO_ERROR || !glIsSemaphoreEXT(imported.Semaphore))
+	{
+		LogError("Failed to import semaphore");
+		return std::nullopt;
+	}
+	semaphoreHandle.ReleaseAfterImport();
+	return imported;
+}
+
+void SignalOSEvent(NOS_HANDLE handle)
+{
+#if defined(_WIN32)
+	SetEvent(handle);
+#elif defined(__linux__)
+	uint64_t dummy = 1;
+	write(handle, &dummy, sizeof(dummy));
+#else
+#error Unsupported platform
+#endif
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <optional>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "Formats.h"
+#include "ResourceRegistry.h"
+
+ // Nodos
+#include "CommonEvents_generated.h"
+#include <nosFlatBuffersCommon.h>
+#include <Nodos/AppAPI.h>
+#include "nosVulkanSubsystem/nosVulkanSubsystem.h"
+
+#if defined(_WIN32)
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include "Windows.h"
+#	define glImportSemaphore glImportSemaphoreWin32HandleEXT
+#	define glImportMemory glImportMemoryWin32HandleEXT
+#	define GL_HANDLE_TYPE GL_HANDLE_TYPE_OPAQUE_WIN32_EXT
+#	define VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT
+#	define VK_EXTERNAL_MEMORY_HANDLE_TYPE VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#	define glImportSemaphore glImportSemaphoreFdEXT
+#	define glImportMemory glImportMemoryFdEXT
+#	define GL_HANDLE_TYPE GL_HANDLE_TYPE_OPAQUE_FD_EXT
+#endif
+
+inline uint64_t GetHandleId(NOS_HANDLE handle)
+{
+	return uint64_t(uintptr_t(handle));
+}
+
+// A handle duplicated from Nodos, closed when destroyed unless ownership went to GL with ReleaseAfterImport
+struct ImportedOSHandle
+{
+	nos::app::IAppServiceClient* Client = nullptr;
+	std::optional<NOS_HANDLE> OSHandle = std::nullopt;
+	ImportedOSHandle(ImportedOSHandle const& other) = delete;
+	ImportedOSHandle& operator=(ImportedOSHandle const& other) = delete;
+	ImportedOSHandle(ImportedOSHandle&& other) noexcept : Client(other.Client), OSHandle(std::exchange(other.OSHandle, std::nullopt)) {}
+	ImportedOSHandle& operator=(ImportedOSHandle&& other) noexcept
+	{
+		CloseHandle();
+		Client = other.Client;
+		OSHandle = std::exchange(other.OSHandle, std::nullopt);
+		return *this;
+	}
+	ImportedOSHandle() : OSHandle(std::nullopt) {}
+	// owner must be a string literal, see TrackResource
+	ImportedOSHandle(nos::app::IAppServiceClient* client, NOS_HANDLE fromHandle, char const* owner) : Client(client), OSHandle(client->DuplicateHandle(fromHandle))
+	{
+		if (OSHandle)
+			TrackResource(TrackedKind::OSHandle, GetHandleId(*OSHandle), owner);
+	}
+	~ImportedOSHandle()
+	{
+		CloseHandle();
+	}
+	void CloseHandle()
+	{
+		if (!OSHandle)
+			return;
+		UntrackResource(TrackedKind::OSHandle, GetHandleId(*OSHandle));
+		Client->CloseHandle(*OSHandle);
+		OSHandle = std::nullopt;
+	}
+	// Call once GL imported the handle successfully
+	void ReleaseAfterImport()
+	{
+#if defined(_WIN32)
+		// GL keeps its own reference to Win32 handles
+		CloseHandle();
+#else
+		// GL owns an imported fd, closing it again would close whatever reuses the number
+		if (OSHandle)
+			UntrackResource(TrackedKind::OSHandle, GetHandleId(*OSHandle));
+		OSHandle = std::nullopt;
+#endif
+	}
+
+	operator NOS_HANDLE() const
+	{
+		return OSHandle.value_or(NOS_HANDLE(0));
+	}
+};
+
+// Objects are tracked by whoever creates them and untracked when released here
+struct GLImportedTexture
+{
+	ImportedOSHandle OSHandle {};
+	GLuint Image{};
+	GLuint Memory{};
+	GLImportedTexture() {}
+	GLImportedTexture(ImportedOSHandle osHandle, GLuint image, GLuint memory) : OSHandle(std::move(osHandle)), Image(image), Memory(memory) {}
+	GLImportedTexture(GLImportedTexture&& other) noexcept
+		: OSHandle(std::move(other.OSHandle)), Image(std::exchange(other.Image, 0)), Memory(std::exchange(other.Memory, 0))
+	{
+	}
+	GLImportedTexture& operator=(GLImportedTexture&& other) noexcept
+	{
+		Release();
+		OSHandle = std::move(other.OSHandle);
+		Image = std::exchange(other.Image, 0);
+		Memory = std::exchange(other.Memory, 0);
+		return *this;
+	}
+	~GLImportedTexture()
+	{
+		Release();
+	}
+	void Release()
+	{
+		if (Image)
+		{
+			UntrackResource(TrackedKind::Texture, Image);
+			glDeleteTextures(1, &Image);
+		}
+		// Textures created locally have no memory object, and the extension may be missing without Nodos
+		if (Memory)
+		{
+			UntrackResource(TrackedKind::MemoryObject, Memory);
+			glDeleteMemoryObjectsEXT(1, &Memory);
+		}
+		Image = 0;
+		Memory = 0;
+		OSHandle.CloseHandle();
+	}
+};
+
+struct GLImportedBuffer
+{
+	ImportedOSHandle OSHandle{};
+	GLuint Buffer{};
+	GLuint Memory{};
+	uint64_t Size = 0;
+	GLImportedBuffer() {}
+	GLImportedBuffer(GLImportedBuffer&& other) noexcept
+		: OSHandle(std::move(other.OSHandle)), Buffer(std::exchange(other.Buffer, 0)), Memory(std::exchange(other.Memory, 0)), Size(std::exchange(other.Size, 0))
+	{
+	}
+	GLImportedBuffer& operator=(GLImportedBuffer&& other) noexcept
+	{
+		Release();
+		OSHandle = std::move(other.OSHandle);
+		Buffer = std::exchange(other.Buffer, 0);
+		Memory = std::exchange(other.Memory, 0);
+		Size = std::exchange(other.Size, 0);
+		return *this;
+	}
+	~GLImportedBuffer()
+	{
+		Release();
+	}
+	void Release()
+	{
+		if (Buffer)
+		{
+			UntrackResource(TrackedKind::Buffer, Buffer);
+			glDeleteBuffers(1, &Buffer);
+		}
+		if (Memory)
+		{
+			UntrackResource(TrackedKind::MemoryObject, Memory);
+			glDeleteMemoryObjectsEXT(1, &Memory);
+		}
+		Buffer = 0;
+		Memory = 0;
+		OSHandle.CloseHandle();
+	}
+};
+
+struct GLImportedSemaphore
+{
+	ImportedOSHandle OSHandle{};
+	GLuint Semaphore{};
+
+	GLImportedSemaphore() {}
+	GLImportedSemaphore(ImportedOSHandle osHandle, GLuint semaphore) : OSHandle(std::move(osHandle)), Semaphore(semaphore) {}
+	GLImportedSemaphore(GLImportedSemaphore&& other) noexcept : OSHandle(std::move(other.OSHandle)), Semaphore(std::exchange(other.Semaphore, 0)) {}
+	GLImportedSemaphore& operator=(GLImportedSemaphore&& other) noexcept
+	{
+		Release();
+		OSHandle = std::move(other.OSHandle);
+		Semaphore = std::exchange(other.Semaphore, 0);
+		return *this;
+	}
+	~GLImportedSemaphore()
+	{
+		Release();
+	}
+	void Release()
+	{
+		if (Semaphore)
+		{
+			UntrackResource(TrackedKind::Semaphore, Semaphore);
+			glDeleteSemaphoresEXT(1, &Semaphore);
+		}
+		Semaphore = 0;
+		OSHandle.CloseHandle();
+	}
+};
+
+// Width of the GL texture backing tex, half the image width for 4:2:2 formats
+uint32_t GetStorageWidth(nos::sys::vulkan::TTexture const& tex);
+// How the Vulkan allocation behind a texture is laid out, GL has to be told before the import
+struct MemoryLayout
+{
+	bool Dedicated = true;
+	bool LinearTiling = false;
+};
+
+// Forces parts of the layout instead of deriving them from the texture description
+struct MemoryImportHints
+{
+	std::optional<bool> Dedicated;
+	std::optional<bool> LinearTiling;
+};
+
+// Imported textures have the format's swizzle applied, so sampling them always yields Vulkan's R, G, B, A.
+// shape describes mip chains, arrays and volumes, which must match the image Nodos allocated.
+// Falls back to the other memory layout candidates if the driver rejects the preferred one.
+std::optional<GLImportedTexture> ImportTexture(nos::app::IAppServiceClient* client, nos::sys::vulkan::TTexture const& tex, TextureShape const& shape = {}, MemoryImportHints const& hints = {});
+// Texture with the size and format described by tex but without external memory, for replaying events without Nodos
+std::optional<GLImportedTexture> CreateStandInTexture(nos::sys::vulkan::TTexture const& tex, TextureShape const& shape = {});
+// Binds the whole allocation range Nodos exported as a buffer object, e.g. for use as an SSBO
+std::optional<GLImportedBuffer> ImportBuffer(nos::app::IAppServiceClient* client, nos::sys::vulkan::TBuffer const& buf);
+// Zero-filled buffer of the described size without external memory
+std::optional<GLImportedBuffer> CreateStandInBuffer(nos::sys::vulkan::TBuffer const& buf);
+std::optional<GLImportedSemaphore> ImportSemaphore(nos::app::IAppServiceClient* client, uint64_t pid, uint64_t handle);
+
+// Signals an event handle shared by Nodos (a Win32 event or an eventfd)
+void SignalOSEvent(NOS_HANDLE handle);
@@ -0,0 +1,333 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "LocalDriver.h"
+#include "AppOptions.h"
+#include "GLContext.h"
+#include "Log.h"
+
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#include <GLFW/glfw3.h>
+
+static void DispatchEvent(AppInstance& instance, flatbuffers::FlatBufferBuilder& fbb)
+{
+	auto event = flatbuffers::GetRoot<nos::app::EngineEvent>(fbb.GetBufferPointer());
+	instance.EventDelegates->HandleEvent(event);
+}
+
+static void SendStateChanged(AppInstance& instance, nos::app::ExecutionState state)
+{
+	flatbuffers::FlatBufferBuilder fbb;
+	nos::app::StateChangedBuilder stateChanged(fbb);
+	stateChanged.add_state(state);
+	auto offset = stateChanged.Finish();
+	nos::app::EngineEventBuilder event(fbb);
+	event.add_event_type(nos::app::EngineEventUnion::StateChanged);
+	event.add_event(offset.Union());
+	fbb.Finish(event.Finish());
+	DispatchEvent(instance, fbb);
+}
+
+static void SendExecuteStart(AppInstance& instance, uint64_t frameNumber)
+{
+	flatbuffers::FlatBufferBuilder fbb;
+	nos::app::AppExecuteStartBuilder executeStart(fbb);
+	executeStart.add_frame_counter(frameNumber);
+	auto offset = executeStart.Finish();
+	nos::app::EngineEventBuilder event(fbb);
+	event.add_event_type(nos::app::EngineEventUnion::AppExecuteStart);
+	event.add_event(offset.Union());
+	fbb.Finish(event.Finish());
+	DispatchEvent(instance, fbb);
+}
+
+bool LocalDriver::Start(GLFWwindow* mainWindow, uint32_t instanceCount)
+{
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		auto& instance = Instances.emplace_back(std::make_unique<AppInstance>(i, nullptr));
+		uint32_t width = 1920, height = 1080;
+		if (!g_Options.SourcePath.empty())
+		{
+			// Each instance reads its own view of the file, the OS shares the pages
+			instance->Source = FileSource::Open(g_Options.SourcePath, g_Options.SourceWidth, g_Options.SourceHeight);
+			if (!instance->Source)
+			{
+				Instances.pop_back();
+				Stop();
+				return false;
+			}
+			width = instance->Source->GetWidth();
+			height = instance->Source->GetHeight();
+		}
+		if (!g_Options.ComparePath.empty())
+		{
+			instance->Golden = GoldenComparator::Open(g_Options.ComparePath, width, height, g_Options.CompareTolerance);
+			if (!instance->Golden)
+			{
+				Instances.pop_back();
+				Stop();
+				return false;
+			}
+		}
+		instance->Tasks.Push([instance = instance.get(), width, height]() { instance->CreateLocalTextures(width, height); });
+		if (!instance->Start(CreateSharedContext(mainWindow)))
+		{
+			Instances.pop_back();
+			Stop();
+			return false;
+		}
+		SendStateChanged(*instance, nos::app::ExecutionState::SYNCED);
+	}
+	Issued.assign(instanceCount, 0);
+	return true;
+}
+
+void LocalDriver::Pump(std::chrono::milliseconds timeout)
+{
+	auto seen = GetFrameEventCount();
+	for (size_t i = 0; i < Instances.size(); ++i)
+	{
+		if (Instances[i]->RenderedFrames == Issued[i] && (!FrameLimit || Issued[i] < FrameLimit))
+			SendExecuteStart(*Instances[i], Issued[i]++);
+	}
+	if (timeout.count())
+		WaitForFrameEvent(seen, timeout);
+}
+
+void LocalDriver::Stop()
+{
+	for (auto& instance : Instances)
+	{
+		SendStateChanged(*instance, nos::app::ExecutionState::IDLE);
+		glfwDestroyWindow(instance->Stop());
+		instance->Preview.ReleaseWindowResources();
+	}
+	// Reports printed after this come after everything the instances logged
+	FlushLog();
+}
+
+// Shows every instance's latest frame side by side in a grid
+static void ShowInstances(GLFWwindow* mainWindow, std::vector<std::unique_ptr<AppInstance>> const& instances)
+{
+	uint32_t count = uint32_t(instances.size());
+	uint32_t columns = uint32_t(std::ceil(std::sqrt(double(count))));
+	uint32_t rows = (count + columns - 1) / columns;
+	bool suspended = IsWindowHidden(mainWindow);
+	for (auto& instance : instances)
+		instance->Preview.SetSuspended(suspended);
+	if (suspended)
+		return;
+	int width, height;
+	glfwGetFramebufferSize(mainWindow, &width, &height);
+	glClearColor(0.0f, 0.3f, 0.3f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	int tileWidth = width / columns, tileHeight = height / rows;
+	for (auto& instance : instances)
+		instance->Preview.Blit((instance->Index % columns) * tileWidth, height - (instance->Index / columns + 1) * tileHeight, tileWidth, tileHeight);
+	glfwSwapBuffers(mainWindow);
+}
+
+int RunFileSource(GLFWwindow* mainWindow)
+{
+	LocalDriver driver;
+	driver.FrameLimit = g_Options.FrameCount;
+	if (!driver.Start(mainWindow, g_Options.InstanceCount))
+		return -1;
+	auto isDone = [&]()
+		{
+			return driver.FrameLimit && std::ranges::all_of(driver.Instances, [&](auto& instance) { return instance->RenderedFrames >= driver.FrameLimit; });
+		};
+	// One frame per instance per refresh, like a Nodos graph running at the display rate
+	while (!glfwWindowShouldClose(mainWindow) && !isDone())
+	{
+		glfwPollEvents();
+		// Without a window to pace us, render as fast as the instances go
+		driver.Pump(std::chrono::milliseconds(g_Options.Headless ? 100 : 0));
+		if (!g_Options.Headless)
+			ShowInstances(mainWindow, driver.Instances);
+	}
+	driver.Stop();
+	bool passed = true;
+	for (auto& instance : driver.Instances)
+		if (instance->Golden)
+			passed &= instance->Golden->Report(instance->Index, driver.FrameLimit ? driver.FrameLimit : instance->RenderedFrames.load());
+	return passed ? 0 : 1;
+}
+
+int RunEventReplay(GLFWwindow* mainWindow)
+{
+	std::vector<std::unique_ptr<EventReplayer>> replayers;
+	for (uint32_t i = 0; i < g_Options.InstanceCount; ++i)
+	{
+		auto replayer = EventReplayer::Open(GetRecordingPath(g_Options.ReplayEventsPath, i));
+		if (!replayer)
+			return -1;
+		replayers.push_back(std::move(replayer));
+	}
+	// Instances without a client stand in for Nodos' handles with local textures and complete frames on the CPU
+	std::vector<std::unique_ptr<AppInstance>> instances;
+	for (uint32_t i = 0; i < g_Options.InstanceCount; ++i)
+	{
+		auto& instance = instances.emplace_back(std::make_unique<AppInstance>(i, nullptr));
+		if (!instance->Start(CreateSharedContext(mainWindow)))
+		{
+			instances.pop_back();
+			for (auto& started : instances)
+				glfwDestroyWindow(started->Stop());
+			return -1;
+		}
+	}
+
+	// Events reach the delegates from their own thread, as they do from the SDK
+	std::atomic_bool stop = false;
+	std::vector<WakeEvent> stopEvents(instances.size());
+	std::atomic<uint32_t> finished = 0;
+	std::vector<size_t> replayed(instances.size());
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		threads.emplace_back([&, i]()
+			{
+				replayed[i] = replayers[i]->Replay(*instances[i]->EventDelegates, g_Options.ReplaySpeed, stop, stopEvents[i]);
+				finished++;
+				glfwPostEmptyEvent();
+			});
+	}
+	while (!glfwWindowShouldClose(mainWindow) && finished < instances.size())
+	{
+		if (g_Options.Headless)
+		{
+			glfwWaitEventsTimeout(0.1);
+			continue;
+		}
+		glfwPollEvents();
+		ShowInstances(mainWindow, instances);
+	}
+	stop = true;
+	for (auto& stopEvent : stopEvents)
+		stopEvent.Signal();
+	for (auto& thread : threads)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (auto& instance : instances)
+	{
+		glfwDestroyWindow(instance->Stop());
+		instance->Preview.ReleaseWindowResources();
+	}
+	FlushLog();
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		auto& instance = instances[i];
+		std::cout << "Instance " << i << ": replayed " << replayed[i] << "/" << replayers[i]->GetRecords().size() << " events in " << seconds
+			<< "s (recorded over " << std::chrono::duration<double>(replayers[i]->GetDuration()).count() << "s), rendered " << instance->RenderedFrames << " frames, skipped " << instance->SkippedFrames << std::endl;
+	}
+	return 0;
+}
+
+// Row r of the check's input holds r in every channel
+static constexpr uint32_t OrientationCheckWidth = 64;
+static constexpr uint32_t OrientationCheckHeight = 256;
+
+// Renders one frame with the current options from a vertical ramp into an RGBA and a YUYV 4:2:2 output, on the
+// calling thread's context. Returns whether each output has the ramp's first row on top.
+static std::optional<std::array<bool, 2>> RenderOrientation()
+{
+	using nos::sys::vulkan::Format;
+	AppInstance instance(0, nullptr);
+	auto createPin = [](ExternalTexture& external, Format format)
+		{
+			external.Texture = {};
+			external.Texture.width = OrientationCheckWidth;
+			external.Texture.height = OrientationCheckHeight;
+			external.Texture.format = format;
+			auto texture = CreateStandInTexture(external.Texture);
+			if (!texture)
+				return false;
+			external.Image = std::move(*texture);
+			return true;
+		};
+	auto& input = instance.State.ShaderInputs[0];
+	auto& outputs = instance.State.ShaderOutputs;
+	if (!createPin(input, Format::R8G8B8A8_UNORM) || !createPin(outputs[0], Format::R8G8B8A8_UNORM) || !createPin(outputs[1], Format::G8B8G8R8_422_UNORM))
+		return std::nullopt;
+	std::vector<uint8_t> ramp(OrientationCheckWidth * OrientationCheckHeight * 4);
+	for (size_t i = 0; i < ramp.size(); ++i)
+		ramp[i] = uint8_t(i / (OrientationCheckWidth * 4));
+	glTextureSubImage2D(input.Image.Image, 0, 0, 0, OrientationCheckWidth, OrientationCheckHeight, GL_RGBA, GL_UNSIGNED_BYTE, ramp.data());
+
+	instance.InitGL();
+	bool rendered = instance.RenderFrame();
+	std::array<bool, 2> topFirst{};
+	for (size_t o = 0; o < outputs.size() && rendered; ++o)
+	{
+		// The first byte of a texel is red for RGBA and the first pixel's luma for YUYV, both follow the ramp
+		uint32_t width = GetStorageWidth(outputs[o].Texture);
+		std::vector<uint8_t> pixels(width * OrientationCheckHeight * 4);
+		glGetTextureImage(outputs[o].Image.Image, 0, GL_RGBA, GL_UNSIGNED_BYTE, GLsizei(pixels.size()), pixels.data());
+		topFirst[o] = pixels.front() < pixels[(OrientationCheckHeight - 1) * width * 4];
+	}
+	instance.ShutdownGL();
+	if (!rendered)
+		return std::nullopt;
+	return topFirst;
+}
+
+int RunOrientationCheck()
+{
+	struct Variant
+	{
+		std::string Name;
+		std::vector<std::string> Effects;
+		double FrameBudgetMs = 0;
+	};
+	std::vector<Variant> variants = {
+		{ "no effects", {} },
+		// The last effect is fused into the pack of the 4:2:2 output
+		{ "one effect", { "copy" } },
+		{ "two effects", { "copy", "copy" } },
+		// With a frame budget, RGBA outputs are upsampled by a fragment copy and nothing is fused
+		{ "a frame budget", {}, 1000 },
+		{ "one effect and a frame budget", { "copy" }, 1000 },
+	};
+	auto options = g_Options;
+	g_Options.InputCount = 1;
+	g_Options.OutputCount = 2;
+	g_Options.BufferCount = 0;
+	g_Options.InputShapes.clear();
+	g_Options.RecordPath.clear();
+	g_Options.ComparePath.clear();
+	// Whichever way the sample pass leaves the image, every output of every variant has to agree with it
+	std::optional<bool> reference;
+	bool passed = true;
+	for (auto& variant : variants)
+	{
+		g_Options.Effects = variant.Effects;
+		g_Options.FrameBudgetMs = variant.FrameBudgetMs;
+		auto topFirst = RenderOrientation();
+		if (!topFirst)
+		{
+			std::cerr << "Orientation check: failed to render with " << variant.Name << std::endl;
+			passed = false;
+			continue;
+		}
+		if (!reference)
+			reference = (*topFirst)[0];
+		bool agrees = (*topFirst)[0] == *reference && (*topFirst)[1] == *reference;
+		std::cout << "Orientation check with " << variant.Name << ": RGBA " << ((*topFirst)[0] ? "top first" : "bottom first")
+			<< ", 4:2:2 " << ((*topFirst)[1] ? "top first" : "bottom first") << (agrees ? "" : " (flipped)") << std::endl;
+		passed &= agrees;
+	}
+	g_Options = std::move(options);
+	FlushLog();
+	return passed ? 0 : 1;
+}
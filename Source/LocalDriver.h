@@ -0,0 +1,41 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "AppInstance.h"
+
+struct GLFWwindow;
+
+// Stands in for Nodos: runs instances without a client, feeding them the same engine events Nodos would send.
+// Inputs come from --source if set, otherwise the instances render from blank textures.
+struct LocalDriver
+{
+	// Creates and starts instanceCount instances, returns false if the source can't be opened
+	bool Start(GLFWwindow* mainWindow, uint32_t instanceCount);
+	// Closed loop like Nodos: starts the next frame on every instance that completed its previous one,
+	// then waits up to timeout for any instance to make progress
+	void Pump(std::chrono::milliseconds timeout);
+	// Puts the instances back to idle and stops them, call on the main thread. The instances are kept for inspection.
+	void Stop();
+
+	std::vector<std::unique_ptr<AppInstance>> Instances;
+	std::vector<uint64_t> Issued;
+	// No frames are started past this many per instance, 0 for no limit
+	uint64_t FrameLimit = 0;
+};
+
+// Shows the instances driven from --source in the window until it is closed or --frames are rendered,
+// checking them against --compare if set. Returns the process exit code.
+int RunFileSource(GLFWwindow* mainWindow);
+// Feeds each instance the events recorded with --record-events at --replay-speed, showing the results until every
+// stream is replayed or the window is closed. Returns the process exit code.
+int RunEventReplay(GLFWwindow* mainWindow);
+// Renders a vertical ramp into an RGBA and a 4:2:2 output without effects, through fragment and fused compute effects
+// and through the upsampling of --frame-budget on the calling thread's context, and fails if any output comes out the other way up. Returns the process exit code.
+int RunOrientationCheck();
@@ -0,0 +1,226 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Log.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+static std::atomic<LogSeverity> MinimumSeverity = LogSeverity::Info;
+static std::atomic<uint32_t> RateLimit = 10;
+
+// Call sites hash into a fixed table, the few that collide share a budget
+struct RateCounter
+{
+	std::atomic<int64_t> Second = -1;
+	std::atomic<uint32_t> Count = 0;
+	std::atomic<uint32_t> Suppressed = 0;
+};
+static std::array<RateCounter, 256> RateCounters;
+
+// Returns false if the call site is over its limit for this second, otherwise sets suppressed to the number of
+// messages dropped since the last one let through. Races between threads only make the limit approximate.
+static bool PassRateLimit(uint64_t key, uint32_t& suppressed)
+{
+	suppressed = 0;
+	uint32_t limit = RateLimit.load(std::memory_order_relaxed);
+	if (limit == 0)
+		return true;
+	auto& counter = RateCounters[(key * 0x9E3779B97F4A7C15ull) >> 56];
+	int64_t second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t counted = counter.Second.load(std::memory_order_relaxed);
+	if (counted != second && counter.Second.compare_exchange_strong(counted, second, std::memory_order_relaxed))
+		counter.Count.store(0, std::memory_order_relaxed);
+	if (counter.Count.fetch_add(1, std::memory_order_relaxed) >= limit)
+	{
+		counter.Suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	suppressed = counter.Suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+// Bounded multi-producer queue with a sequence number per slot, drained by a single thread
+class Logger
+{
+public:
+	Logger()
+	{
+		for (size_t i = 0; i < Slots.size(); ++i)
+			Slots[i].Sequence.store(i, std::memory_order_relaxed);
+		Thread = std::thread([this]() { Run(); });
+	}
+
+	~Logger()
+	{
+		Stopping = true;
+		Published.fetch_add(1);
+		Published.notify_one();
+		Thread.join();
+	}
+
+	void Push(LogSeverity severity, uint32_t suppressed, std::string_view message)
+	{
+		uint64_t position = EnqueuePosition.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true)
+		{
+			slot = &Slots[position % Slots.size()];
+			uint64_t sequence = slot->Sequence.load(std::memory_order_acquire);
+			if (sequence == position)
+			{
+				if (EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (sequence < position)
+			{
+				// The writer is a whole ring behind
+				Dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			else
+				position = EnqueuePosition.load(std::memory_order_relaxed);
+		}
+		slot->Severity = severity;
+		slot->Suppressed = suppressed;
+		slot->Length = uint16_t(std::min(message.size(), MaxLogMessageLength));
+		memcpy(slot->Text, message.data(), slot->Length);
+		slot->Sequence.store(position + 1, std::memory_order_release);
+		Published.fetch_add(1, std::memory_order_release);
+		Published.notify_one();
+	}
+
+	void Flush()
+	{
+		uint64_t target = EnqueuePosition.load();
+		uint64_t written = Written.load();
+		while (written < target)
+		{
+			Written.wait(written);
+			written = Written.load();
+		}
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> Sequence;
+		LogSeverity Severity;
+		uint32_t Suppressed;
+		uint16_t Length;
+		char Text[MaxLogMessageLength];
+	};
+
+	void Run()
+	{
+		while (true)
+		{
+			uint64_t published = Published.load(std::memory_order_acquire);
+			bool stopping = Stopping;
+			Drain();
+			if (stopping)
+				break;
+			Published.wait(published);
+		}
+	}
+
+	void Drain()
+	{
+		bool wrote = false;
+		while (true)
+		{
+			auto& slot = Slots[DequeuePosition % Slots.size()];
+			if (slot.Sequence.load(std::memory_order_acquire) != DequeuePosition + 1)
+				break;
+			auto& stream = slot.Severity >= LogSeverity::Warning ? std::cerr : std::cout;
+			stream.write(slot.Text, slot.Length);
+			if (slot.Suppressed)
+				stream << " (" << slot.Suppressed << " similar messages suppressed)";
+			stream << '\n';
+			slot.Sequence.store(DequeuePosition + Slots.size(), std::memory_order_release);
+			DequeuePosition++;
+			wrote = true;
+		}
+		if (uint64_t dropped = Dropped.exchange(0, std::memory_order_relaxed))
+		{
+			std::cerr << "Log: " << dropped << " messages dropped, the log ring was full\n";
+			wrote = true;
+		}
+		if (!wrote)
+			return;
+		std::cout.flush();
+		std::cerr.flush();
+		Written.store(DequeuePosition);
+		Written.notify_all();
+	}
+
+	std::array<Slot, 256> Slots;
+	std::atomic<uint64_t> EnqueuePosition = 0;
+	// Consumer only
+	uint64_t DequeuePosition = 0;
+	// Bumped after every push, the consumer sleeps on it
+	std::atomic<uint64_t> Published = 0;
+	// Messages written so far, for Flush
+	std::atomic<uint64_t> Written = 0;
+	std::atomic<uint64_t> Dropped = 0;
+	std::atomic_bool Stopping = false;
+	std::thread Thread;
+};
+
+void LogStream::Reset()
+{
+	LogBuffer::Reset();
+	clear();
+	flags(std::ios_base::dec | std::ios_base::skipws);
+	precision(6);
+	width(0);
+}
+
+LogStream& BeginLogMessage()
+{
+	thread_local LogStream stream;
+	stream.Reset();
+	return stream;
+}
+
+static Logger& GetLogger()
+{
+	static Logger logger;
+	return logger;
+}
+
+void SetLogSeverity(LogSeverity minimum)
+{
+	MinimumSeverity = minimum;
+}
+
+void SetLogRateLimit(uint32_t perSecond)
+{
+	RateLimit = perSecond;
+}
+
+bool IsLogged(LogSeverity severity)
+{
+	return severity >= MinimumSeverity.load(std::memory_order_relaxed);
+}
+
+void LogMessage(LogSeverity severity, uint64_t key, std::string_view message)
+{
+	if (!IsLogged(severity))
+		return;
+	uint32_t suppressed;
+	if (!PassRateLimit(key, suppressed))
+		return;
+	GetLogger().Push(severity, suppressed, message);
+}
+
+void FlushLog()
+{
+	GetLogger().Flush();
+}
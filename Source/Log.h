@@ -0,0 +1,96 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+enum class LogSeverity : uint8_t
+{
+	Debug,
+	Info,
+	Warning,
+	Error,
+};
+
+// Messages are formatted on the calling thread into a slot of a lock-free ring and written to the console by a background
+// thread, so logging never waits for the console. Messages longer than MaxLogMessageLength are cut and messages logged
+// while the ring is full are dropped and counted.
+// Each call site may log at most the rate limit per second, the rest are counted and reported with its next message.
+constexpr size_t MaxLogMessageLength = 2048;
+
+void SetLogSeverity(LogSeverity minimum);
+// Messages per second per call site, 0 disables the limit
+void SetLogRateLimit(uint32_t perSecond);
+bool IsLogged(LogSeverity severity);
+// key identifies the call site for rate limiting
+void LogMessage(LogSeverity severity, uint64_t key, std::string_view message);
+// Blocks until everything logged so far is written
+void FlushLog();
+
+struct LogBuffer : std::streambuf
+{
+	LogBuffer() { Reset(); }
+	void Reset() { setp(Data, Data + sizeof(Data)); }
+	std::string_view View() const { return { pbase(), size_t(pptr() - pbase()) }; }
+
+	char Data[MaxLogMessageLength];
+};
+
+// Formats into a fixed buffer without allocating, stops writing when it is full
+class LogStream : LogBuffer, public std::ostream
+{
+public:
+	LogStream() : std::ostream(static_cast<LogBuffer*>(this)) {}
+	// Empties the buffer and restores default formatting
+	void Reset();
+	std::string_view View() const { return LogBuffer::View(); }
+};
+
+// The calling thread's stream, emptied
+LogStream& BeginLogMessage();
+
+template <typename... Args>
+void LogWithKey(LogSeverity severity, uint64_t key, Args const&... args)
+{
+	if (!IsLogged(severity))
+		return;
+	auto& stream = BeginLogMessage();
+	(stream << ... << args);
+	LogMessage(severity, key, stream.View());
+}
+
+// Every message starts with a literal, whose address tells call sites apart
+template <size_t N, typename... Args>
+void Log(LogSeverity severity, char const (&text)[N], Args const&... args)
+{
+	LogWithKey(severity, uint64_t(uintptr_t(text)), text, args...);
+}
+
+template <size_t N, typename... Args>
+void LogDebug(char const (&text)[N], Args const&... args)
+{
+	Log(LogSeverity::Debug, text, args...);
+}
+
+template <size_t N, typename... Args>
+void LogInfo(char const (&text)[N], Args const&... args)
+{
+	Log(LogSeverity::Info, text, args...);
+}
+
+template <size_t N, typename... Args>
+void LogWarning(char const (&text)[N], Args const&... args)
+{
+	Log(LogSeverity::Warning, text, args...);
+}
+
+template <size_t N, typename... Args>
+void LogError(char const (&text)[N], Args const&... args)
+{
+	Log(LogSeverity::Error, text, args...);
+}
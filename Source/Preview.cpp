@@ -0,0 +1,141 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Preview.h"
+#include "Shaders.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <utility>
+
+// Used until the window reports the size it shows the preview at
+static constexpr uint32_t DefaultTargetWidth = 1920;
+static constexpr uint32_t DefaultTargetHeight = 1080;
+
+PublishResult PreviewChannel::Publish(GLuint texture, uint32_t width, uint32_t height)
+{
+	uint32_t rate = Rate;
+	if (Suspended || rate == 0 || FrameCount++ % rate != 0 || !texture || !width || !height)
+		return PublishResult::Skipped;
+	uint32_t targetWidth = TargetWidth ? TargetWidth.load() : DefaultTargetWidth;
+	uint32_t targetHeight = TargetHeight ? TargetHeight.load() : DefaultTargetHeight;
+	// Integer factor so every preview texel averages whole source texels, the window stretches the rest
+	uint32_t factor = std::max({ 1u, (width + targetWidth - 1) / targetWidth, (height + targetHeight - 1) / targetHeight });
+	uint32_t previewWidth = (width + factor - 1) / factor, previewHeight = (height + factor - 1) / factor;
+
+	// Write into the slot the window is not showing
+	int index;
+	GLsync read;
+	GLuint oldTexture = 0;
+	{
+		std::unique_lock lock(Mutex);
+		index = Published == 0 ? 1 : 0;
+		auto& slot = Slots[index];
+		read = std::exchange(slot.Read, nullptr);
+		if (slot.Width != previewWidth || slot.Height != previewHeight)
+		{
+			oldTexture = std::exchange(slot.Texture, 0);
+			slot.Width = previewWidth;
+			slot.Height = previewHeight;
+			Generation++;
+		}
+	}
+	auto& slot = Slots[index];
+	if (read)
+	{
+		glWaitSync(read, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(read);
+	}
+	if (oldTexture)
+	{
+		UntrackResource(TrackedKind::Texture, oldTexture);
+		glDeleteTextures(1, &oldTexture);
+		GetGLState().InvalidateBindings();
+	}
+	if (!slot.Texture)
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &slot.Texture);
+		TrackResource(TrackedKind::Texture, slot.Texture, "preview");
+		glTextureStorage2D(slot.Texture, 1, GL_RGBA8, previewWidth, previewHeight);
+		glTextureParameteri(slot.Texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(slot.Texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	auto& state = GetGLState();
+	state.UseProgram(GetPreviewProgram());
+	state.BindTextureUnit(0, texture);
+	state.BindImageTexture(0, slot.Texture, GL_RGBA8);
+	glDispatchCompute((previewWidth + 7) / 8, (previewHeight + 7) / 8, 1);
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	GLsync written = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// The main thread waits on the fence from its own context, which only works once it is flushed
+	glFlush();
+
+	std::unique_lock lock(Mutex);
+	if (slot.Written)
+		glDeleteSync(slot.Written);
+	slot.Written = written;
+	Published = index;
+	return oldTexture ? PublishResult::Resized : PublishResult::Published;
+}
+
+void PreviewChannel::ReleaseRenderResources()
+{
+	std::unique_lock lock(Mutex);
+	Published = -1;
+	Generation++;
+	for (auto& slot : Slots)
+	{
+		if (slot.Texture)
+		{
+			UntrackResource(TrackedKind::Texture, slot.Texture);
+			glDeleteTextures(1, &slot.Texture);
+		}
+		for (auto sync : { slot.Written, slot.Read })
+			if (sync)
+				glDeleteSync(sync);
+		slot = {};
+	}
+	GetGLState().InvalidateBindings();
+}
+
+void PreviewChannel::Clear()
+{
+	std::unique_lock lock(Mutex);
+	Published = -1;
+}
+
+void PreviewChannel::Blit(int x, int y, int width, int height)
+{
+	TargetWidth = uint32_t(std::max(width, 1));
+	TargetHeight = uint32_t(std::max(height, 1));
+	std::unique_lock lock(Mutex);
+	if (Published < 0)
+		return;
+	auto& slot = Slots[Published];
+	if (!FBO)
+		glCreateFramebuffers(1, &FBO);
+	glWaitSync(slot.Written, 0, GL_TIMEOUT_IGNORED);
+	if (AttachedTexture != slot.Texture || AttachedGeneration != Generation)
+	{
+		glNamedFramebufferTexture(FBO, GL_COLOR_ATTACHMENT0, slot.Texture, 0);
+		AttachedTexture = slot.Texture;
+		AttachedGeneration = Generation;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, slot.Width, slot.Height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	if (slot.Read)
+		glDeleteSync(slot.Read);
+	slot.Read = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
+
+void PreviewChannel::ReleaseWindowResources()
+{
+	if (FBO)
+		glDeleteFramebuffers(1, &FBO);
+	FBO = 0;
+	AttachedTexture = 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <glad/glad.h>
+
+// What publishing a frame did to the bindings of the render thread's state cache
+enum class PublishResult
+{
+	// Nothing was bound
+	Skipped,
+	// The reduction program and its textures were bound
+	Published,
+	// The preview texture was resized, which invalidates every binding
+	Resized,
+};
+
+// Hands downscaled copies of an instance's output from its render thread to the window.
+// Every Nth frame is reduced by a compute pass to roughly the size the window last showed it at, into one of two
+// textures owned by the channel, so the window never reads the output itself and full-resolution blits are avoided.
+// Publishing stops entirely while the window is suspended (e.g. iconified) or the rate is 0.
+class PreviewChannel
+{
+public:
+	PreviewChannel() = default;
+	PreviewChannel(PreviewChannel const&) = delete;
+	PreviewChannel& operator=(PreviewChannel const&) = delete;
+
+	// Render thread: called after every rendered frame with the texture to show
+	PublishResult Publish(GLuint texture, uint32_t width, uint32_t height);
+	// Render thread: deletes the downscaled textures, call before its context goes away
+	void ReleaseRenderResources();
+	// Any thread: stops showing the last published frame
+	void Clear();
+
+	// Main thread, with the window's context current. Also records the size the next frames are reduced to.
+	void Blit(int x, int y, int width, int height);
+	// Main thread: deletes the framebuffer used for blitting
+	void ReleaseWindowResources();
+	void SetSuspended(bool suspended) { Suspended = suspended; }
+	// Publish every rate-th frame, 0 disables the preview
+	void SetRate(uint32_t rate) { Rate = rate; }
+
+private:
+	struct Slot
+	{
+		GLuint Texture = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		// Signaled when the render thread's reduction into Texture completes
+		GLsync Written = nullptr;
+		// Signaled when the window's last blit from Texture completes, the render thread waits on it before writing again
+		GLsync Read = nullptr;
+	};
+
+	std::mutex Mutex;
+	std::array<Slot, 2> Slots;
+	// Slot the window shows, -1 for none
+	int Published = -1;
+	// Bumped whenever a slot texture is replaced, so the window re-attaches even if a name is reused
+	uint64_t Generation = 0;
+
+	std::atomic<uint32_t> Rate = 1;
+	std::atomic_bool Suspended = false;
+	std::atomic<uint32_t> TargetWidth = 0;
+	std::atomic<uint32_t> TargetHeight = 0;
+	// Render thread only
+	uint64_t FrameCount = 0;
+
+	// Main thread only
+	GLuint FBO = 0;
+	GLuint AttachedTexture = 0;
+	uint64_t AttachedGeneration = 0;
+};
@@ -0,0 +1,252 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Recorder.h"
+#include "Log.h"
+
+#include <filesystem>
+#include <string_view>
+
+static constexpr std::string_view FrameHeader = "FRAME\n";
+
+std::string GetRecordingPath(std::string const& path, uint32_t instanceIndex)
+{
+	if (instanceIndex == 0)
+		return path;
+	std::filesystem::path p(path);
+	auto stem = p.stem().string() + "-" + std::to_string(instanceIndex);
+	return (p.parent_path() / (stem + p.extension().string())).string();
+}
+
+std::unique_ptr<FrameRecorder> FrameRecorder::Open(std::string const& path, uint32_t fps)
+{
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		LogError("Failed to open ", path, " for recording");
+		return nullptr;
+	}
+	// Frames are written whole, buffering them again only adds a copy
+	std::setvbuf(file, nullptr, _IONBF, 0);
+	bool isY4M = std::filesystem::path(path).extension() == ".y4m";
+	return std::unique_ptr<FrameRecorder>(new FrameRecorder(path, file, isY4M, fps, nullptr, true));
+}
+
+std::unique_ptr<FrameRecorder> FrameRecorder::Create(std::string name, FrameSink sink, bool dropFrames)
+{
+	return std::unique_ptr<FrameRecorder>(new FrameRecorder(std::move(name), nullptr, false, 0, std::move(sink), dropFrames));
+}
+
+FrameRecorder::FrameRecorder(std::string path, std::FILE* file, bool isY4M, uint32_t fps, FrameSink sink, bool dropFrames)
+	: Path(std::move(path)), File(file), IsY4M(isY4M), Fps(fps), Sink(std::move(sink)), DropFrames(dropFrames)
+{
+	Writer = std::thread([this]() { WriterThread(); });
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	if (!Closed)
+		LogWarning("Recorder for ", Path, " destroyed without Close, buffers are leaked");
+	if (Writer.joinable())
+	{
+		{
+			std::unique_lock lock(Mutex);
+			StopWriter = true;
+		}
+		CV.notify_all();
+		Writer.join();
+	}
+	if (File)
+		std::fclose(File);
+}
+
+bool FrameRecorder::AllocateRing(uint32_t width, uint32_t height)
+{
+	Width = width;
+	Height = height;
+	FrameSize = size_t(width) * height * 4;
+	for (auto& slot : Slots)
+	{
+		glCreateBuffers(1, &slot.Buffer);
+		GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glNamedBufferStorage(slot.Buffer, FrameSize, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+		slot.Mapped = static_cast<const uint8_t*>(glMapNamedBufferRange(slot.Buffer, 0, FrameSize, flags));
+		if (!slot.Mapped)
+		{
+			LogError("Failed to map recorder buffer");
+			return false;
+		}
+	}
+	if (IsY4M)
+	{
+		// Frame header and the three planes go out in a single write
+		Staging.assign(FrameHeader.begin(), FrameHeader.end());
+		Staging.resize(FrameHeader.size() + FrameSize / 4 * 3);
+	}
+	return true;
+}
+
+FrameRecorder::Slot* FrameRecorder::FindFreeSlot(size_t& index)
+{
+	for (index = 0; index < RingSize; ++index)
+		if (Slots[index].State.load(std::memory_order_acquire) == SlotState::Free)
+			return &Slots[index];
+	return nullptr;
+}
+
+void FrameRecorder::Capture(GLuint texture, uint32_t width, uint32_t height, uint64_t frameNumber, GLenum format)
+{
+	if (Closed)
+		return;
+	if (!FrameSize && !AllocateRing(width, height))
+	{
+		Close();
+		return;
+	}
+	CollectCompleted(false);
+	if (width != Width || height != Height)
+	{
+		Dropped++;
+		return;
+	}
+	size_t index = 0;
+	Slot* free = FindFreeSlot(index);
+	if (!free && !DropFrames)
+	{
+		CollectCompleted(true);
+		std::unique_lock lock(Mutex);
+		SlotFreedCV.wait(lock, [&]() { return (free = FindFreeSlot(index)) != nullptr; });
+	}
+	if (!free)
+	{
+		Dropped++;
+		return;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, free->Buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glGetTextureImage(texture, 0, format, GL_UNSIGNED_BYTE, GLsizei(FrameSize), nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	free->Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	free->FrameNumber = frameNumber;
+	free->State.store(SlotState::Reading, std::memory_order_relaxed);
+	InFlight.push_back(index);
+}
+
+void FrameRecorder::CollectCompleted(bool wait)
+{
+	while (!InFlight.empty())
+	{
+		auto& slot = Slots[InFlight.front()];
+		GLenum result = glClientWaitSync(slot.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GL_TIMEOUT_IGNORED : 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+		if (result == GL_WAIT_FAILED)
+			LogError("Failed to wait for recorder readback");
+		glDeleteSync(slot.Fence);
+		slot.Fence = nullptr;
+		slot.State.store(SlotState::Writing, std::memory_order_relaxed);
+		{
+			std::unique_lock lock(Mutex);
+			WriteQueue.push_back(InFlight.front());
+		}
+		CV.notify_one();
+		InFlight.pop_front();
+	}
+}
+
+void FrameRecorder::Close()
+{
+	if (Closed)
+		return;
+	CollectCompleted(true);
+	{
+		std::unique_lock lock(Mutex);
+		StopWriter = true;
+	}
+	CV.notify_all();
+	if (Writer.joinable())
+		Writer.join();
+	for (auto& slot : Slots)
+	{
+		if (!slot.Buffer)
+			continue;
+		if (slot.Mapped)
+			glUnmapNamedBuffer(slot.Buffer);
+		glDeleteBuffers(1, &slot.Buffer);
+		slot.Buffer = 0;
+		slot.Mapped = nullptr;
+	}
+	if (File)
+		std::fclose(File);
+	File = nullptr;
+	Closed = true;
+	if (Sink)
+		LogInfo("Readback ", Path, ": ", Written, " frames passed, ", Dropped, " failed or dropped");
+	else
+		LogInfo("Recorded ", Written, " frames to ", Path, ", dropped ", Dropped);
+}
+
+void FrameRecorder::WriterThread()
+{
+	while (true)
+	{
+		size_t index;
+		{
+			std::unique_lock lock(Mutex);
+			CV.wait(lock, [this]() { return StopWriter || !WriteQueue.empty(); });
+			// Drain before stopping so Close keeps every captured frame
+			if (WriteQueue.empty())
+				return;
+			index = WriteQueue.front();
+			WriteQueue.pop_front();
+		}
+		auto& slot = Slots[index];
+		bool written = Sink ? Sink(slot.Mapped, Width, Height, slot.FrameNumber) : !WriteFailed && WriteFrame(slot);
+		if (written)
+			Written++;
+		else
+			Dropped++;
+		{
+			std::unique_lock lock(Mutex);
+			slot.State.store(SlotState::Free, std::memory_order_release);
+		}
+		SlotFreedCV.notify_one();
+	}
+}
+
+bool FrameRecorder::WriteFrame(Slot const& slot)
+{
+	auto write = [this](const void* data, size_t size)
+		{
+			if (std::fwrite(data, 1, size, File) == size)
+				return true;
+			LogError("Failed to write to ", Path, ", stopping recording");
+			WriteFailed = true;
+			return false;
+		};
+	if (!IsY4M)
+		return write(slot.Mapped, FrameSize);
+
+	if (!HeaderWritten)
+	{
+		std::string header = "YUV4MPEG2 W" + std::to_string(Width) + " H" + std::to_string(Height) + " F" + std::to_string(Fps) + ":1 Ip A1:1 C444\n";
+		if (!write(header.data(), header.size()))
+			return false;
+		HeaderWritten = true;
+	}
+	// BT.709 limited range, 8-bit fixed point
+	size_t pixelCount = size_t(Width) * Height;
+	uint8_t* y = Staging.data() + FrameHeader.size();
+	uint8_t* u = y + pixelCount;
+	uint8_t* v = u + pixelCount;
+	const uint8_t* rgba = slot.Mapped;
+	for (size_t i = 0; i < pixelCount; ++i, rgba += 4)
+	{
+		int r = rgba[0], g = rgba[1], b = rgba[2];
+		y[i] = uint8_t(((47 * r + 157 * g + 16 * b + 128) >> 8) + 16);
+		u[i] = uint8_t(((-26 * r - 87 * g + 113 * b + 128) >> 8) + 128);
+		v[i] = uint8_t(((112 * r - 102 * g - 10 * b + 128) >> 8) + 128);
+	}
+	return write(Staging.data(), Staging.size());
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Streams rendered frames to disk without stalling the render thread.
+// Frames are read back into a ring of persistently mapped pixel buffers, and a fence per buffer tells when the copy
+// landed. Completed buffers are written by a separate thread straight from the mapping, one write per frame.
+// If every buffer is still in flight or waiting for the writer, the frame is dropped and counted.
+// Files ending in .y4m are written as 8-bit 4:4:4 BT.709 YUV, anything else as raw RGBA8 frames.
+// Frames can also be handed to a sink instead of a file, e.g. for comparing them against references.
+struct FrameRecorder
+{
+	// Called on the writer thread with a tightly packed RGBA8 frame, returns false to count the frame as dropped
+	using FrameSink = std::function<bool(const uint8_t* rgba, uint32_t width, uint32_t height, uint64_t frameNumber)>;
+
+	// Returns nullptr if the file can't be created
+	static std::unique_ptr<FrameRecorder> Open(std::string const& path, uint32_t fps);
+	// With dropFrames false, Capture waits for a free buffer instead of dropping the frame
+	static std::unique_ptr<FrameRecorder> Create(std::string name, FrameSink sink, bool dropFrames);
+	FrameRecorder(FrameRecorder const&) = delete;
+	FrameRecorder& operator=(FrameRecorder const&) = delete;
+	~FrameRecorder();
+
+	// Queues a readback of texture, call with the context that renders to it current and before handing it back to Nodos.
+	// The recording size is fixed by the first captured frame. format is GL_BGRA for textures holding BGR-ordered data
+	// and one of the _INTEGER formats for integer textures.
+	void Capture(GLuint texture, uint32_t width, uint32_t height, uint64_t frameNumber, GLenum format = GL_RGBA);
+	// Writes every frame already captured and releases the buffers, call on the capturing thread
+	void Close();
+
+	uint64_t GetWrittenFrames() const { return Written; }
+	uint64_t GetDroppedFrames() const { return Dropped; }
+
+private:
+	FrameRecorder(std::string path, std::FILE* file, bool isY4M, uint32_t fps, FrameSink sink, bool dropFrames);
+
+	static constexpr size_t RingSize = 4;
+	enum class SlotState
+	{
+		Free,
+		// Waiting for the GPU copy
+		Reading,
+		// Owned by the writer thread
+		Writing,
+	};
+	struct Slot
+	{
+		GLuint Buffer = 0;
+		const uint8_t* Mapped = nullptr;
+		GLsync Fence = nullptr;
+		uint64_t FrameNumber = 0;
+		std::atomic<SlotState> State = SlotState::Free;
+	};
+
+	bool AllocateRing(uint32_t width, uint32_t height);
+	// Hands slots whose copy completed to the writer, in capture order
+	void CollectCompleted(bool wait);
+	Slot* FindFreeSlot(size_t& index);
+	void WriterThread();
+	bool WriteFrame(Slot const& slot);
+
+	std::string Path;
+	std::FILE* File;
+	bool IsY4M;
+	uint32_t Fps;
+	FrameSink Sink;
+	bool DropFrames;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	size_t FrameSize = 0;
+	std::array<Slot, RingSize> Slots;
+	// Slots in Reading state, oldest first
+	std::deque<size_t> InFlight;
+	std::atomic<uint64_t> Written = 0;
+	std::atomic<uint64_t> Dropped = 0;
+	bool Closed = false;
+
+	// Writer thread state
+	std::mutex Mutex;
+	std::condition_variable CV;
+	// Signaled when the writer frees a slot
+	std::condition_variable SlotFreedCV;
+	std::deque<size_t> WriteQueue;
+	bool StopWriter = false;
+	std::thread Writer;
+	std::vector<uint8_t> Staging;
+	bool HeaderWritten = false;
+	bool WriteFailed = false;
+};
+
+// Instance 0 records to path, other instances insert "-<index>" before the extension
+std::string GetRecordingPath(std::string const& path, uint32_t instanceIndex);
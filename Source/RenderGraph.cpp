@@ -0,0 +1,339 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "RenderGraph.h"
+#include "GLState.h"
+#include "Log.h"
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Transients are RGBA16F, the rest is counted as 4 bytes per texel
+static uint64_t GetTextureBytes(TextureDesc const& desc)
+{
+	uint64_t bytesPerTexel = desc.Format == GL_RGBA16F ? 8 : desc.Format == GL_RGBA32F ? 16 : 4;
+	return bytesPerTexel * desc.Width * desc.Height;
+}
+
+TexturePool::~TexturePool()
+{
+	Clear();
+}
+
+GLuint TexturePool::Acquire(TextureDesc const& desc)
+{
+	auto it = Free.find(desc);
+	if (it != Free.end() && !it->second.empty())
+	{
+		GLuint texture = it->second.back();
+		it->second.pop_back();
+		return texture;
+	}
+	GLuint texture = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, desc.Format, desc.Width, desc.Height);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	TrackResource(TrackedKind::Texture, texture, "render graph pool");
+	Descs[texture] = desc;
+	Bytes += GetTextureBytes(desc);
+	return texture;
+}
+
+void TexturePool::Release(GLuint texture)
+{
+	auto it = Descs.find(texture);
+	if (it == Descs.end())
+	{
+		LogError("TexturePool: Releasing unknown texture ", texture);
+		return;
+	}
+	Free[it->second].push_back(texture);
+}
+
+void TexturePool::Trim()
+{
+	for (auto& [desc, textures] : Free)
+	{
+		for (auto texture : textures)
+		{
+			UntrackResource(TrackedKind::Texture, texture);
+			glDeleteTextures(1, &texture);
+			Descs.erase(texture);
+			Bytes -= GetTextureBytes(desc);
+		}
+	}
+	Free.clear();
+	GetGLState().InvalidateBindings();
+}
+
+void TexturePool::Clear()
+{
+	for (auto& [texture, desc] : Descs)
+	{
+		UntrackResource(TrackedKind::Texture, texture);
+		glDeleteTextures(1, &texture);
+	}
+	Descs.clear();
+	Free.clear();
+	Bytes = 0;
+	GetGLState().InvalidateBindings();
+}
+
+RenderGraph::~RenderGraph()
+{
+	Clear();
+}
+
+ResourceId RenderGraph::AddExternal(std::string name)
+{
+	Resources.push_back(Resource{ .Name = std::move(name), .External = true });
+	Dirty = true;
+	return ResourceId(Resources.size() - 1);
+}
+
+ResourceId RenderGraph::AddTransient(std::string name, GLenum format, ResourceId sizeSource, float scale)
+{
+	return AddTransient(std::move(name), format, sizeSource, scale, scale);
+}
+
+ResourceId RenderGraph::AddTransient(std::string name, GLenum format, ResourceId sizeSource, float scaleX, float scaleY)
+{
+	Resources.push_back(Resource{ .Name = std::move(name), .Format = format, .SizeSource = sizeSource, .ScaleX = scaleX, .ScaleY = scaleY });
+	Dirty = true;
+	return ResourceId(Resources.size() - 1);
+}
+
+ResourceId RenderGraph::AddDynamicTransient(std::string name, GLenum format, ResourceId sizeSource, float scaleX, float scaleY)
+{
+	auto id = AddTransient(std::move(name), format, sizeSource, scaleX, scaleY);
+	Resources[id].Dynamic = true;
+	return id;
+}
+
+void RenderGraph::AddPass(RenderPass pass)
+{
+	Passes.push_back(std::move(pass));
+	Dirty = true;
+}
+
+void RenderGraph::Clear()
+{
+	ReleaseTransients();
+	for (auto& compiled : Compiled)
+		if (compiled.FBO)
+			glDeleteFramebuffers(1, &compiled.FBO);
+	Compiled.clear();
+	Passes.clear();
+	Resources.clear();
+	if (EmptyVAO)
+		glDeleteVertexArrays(1, &EmptyVAO);
+	EmptyVAO = 0;
+	Dirty = true;
+	GetGLState().InvalidateBindings();
+}
+
+void RenderGraph::SetExternal(ResourceId id, GLuint texture, uint32_t width, uint32_t height, GLenum format)
+{
+	auto& res = Resources[id];
+	if (res.Width != width || res.Height != height)
+		Dirty = true;
+	res.Texture = texture;
+	res.Format = format;
+	res.Width = width;
+	res.Height = height;
+}
+
+void RenderGraph::SetDynamicScale(float scale)
+{
+	if (scale == DynamicScale)
+		return;
+	DynamicScale = scale;
+	Dirty = true;
+}
+
+bool RenderGraph::IsReady() const
+{
+	for (auto& res : Resources)
+		if (res.External && !res.Texture)
+			return false;
+	return !Passes.empty();
+}
+
+void RenderGraph::ReleaseTransients()
+{
+	for (auto texture : Held)
+		Pool.Release(texture);
+	Held.clear();
+	for (auto& res : Resources)
+		if (!res.External)
+			res.Texture = 0;
+}
+
+void RenderGraph::Compile()
+{
+	ReleaseTransients();
+
+	// Resolve transient sizes, sources may themselves be transients declared earlier
+	for (auto& res : Resources)
+	{
+		if (res.External)
+			continue;
+		auto& source = Resources[res.SizeSource];
+		float dynamicScale = res.Dynamic ? DynamicScale : 1.0f;
+		res.Width = std::max(1u, uint32_t(std::lround(source.Width * res.ScaleX * dynamicScale)));
+		res.Height = std::max(1u, uint32_t(std::lround(source.Height * res.ScaleY * dynamicScale)));
+	}
+
+	// Lifetime of each transient as [first pass, last pass]
+	std::vector<std::pair<size_t, size_t>> lifetimes(Resources.size(), { SIZE_MAX, 0 });
+	for (size_t i = 0; i < Passes.size(); ++i)
+	{
+		auto touch = [&](ResourceId id) {
+			lifetimes[id].first = std::min(lifetimes[id].first, i);
+			lifetimes[id].second = std::max(lifetimes[id].second, i);
+		};
+		std::for_each(Passes[i].Inputs.begin(), Passes[i].Inputs.end(), touch);
+		std::for_each(Passes[i].Outputs.begin(), Passes[i].Outputs.end(), touch);
+	}
+
+	// Textures whose transient is dead can back a later transient of the same format and size.
+	// Outputs are acquired before inputs of the same pass are retired, so a pass never reads and writes the same texture.
+	std::unordered_map<TextureDesc, std::vector<GLuint>, TextureDescHash> retired;
+	for (size_t i = 0; i < Passes.size(); ++i)
+	{
+		for (ResourceId id = 0; id < Resources.size(); ++id)
+		{
+			auto& res = Resources[id];
+			if (res.External || lifetimes[id].first != i)
+				continue;
+			TextureDesc desc{ res.Format, res.Width, res.Height };
+			auto& candidates = retired[desc];
+			if (!candidates.empty())
+			{
+				res.Texture = candidates.back();
+				candidates.pop_back();
+			}
+			else
+			{
+				res.Texture = Pool.Acquire(desc);
+				Held.push_back(res.Texture);
+			}
+		}
+		for (ResourceId id = 0; id < Resources.size(); ++id)
+		{
+			auto& res = Resources[id];
+			if (!res.External && lifetimes[id].first != SIZE_MAX && lifetimes[id].second == i)
+				retired[{ res.Format, res.Width, res.Height }].push_back(res.Texture);
+		}
+	}
+
+	Compiled.resize(Passes.size());
+	if (!EmptyVAO)
+		glCreateVertexArrays(1, &EmptyVAO);
+	CompileCount++;
+	Dirty = false;
+}
+
+void RenderGraph::UpdateAttachments(RenderPass const& pass, CompiledPass& compiled)
+{
+	std::vector<GLuint> textures;
+	for (auto id : pass.Outputs)
+		textures.push_back(Resources[id].Texture);
+	if (compiled.FBO && textures == compiled.Attached)
+		return;
+	if (!compiled.FBO)
+		glCreateFramebuffers(1, &compiled.FBO);
+	std::vector<GLenum> drawBuffers;
+	for (size_t i = 0; i < std::max(textures.size(), compiled.Attached.size()); ++i)
+	{
+		GLuint texture = i < textures.size() ? textures[i] : 0;
+		glNamedFramebufferTexture(compiled.FBO, GLenum(GL_COLOR_ATTACHMENT0 + i), texture, 0);
+		if (texture)
+			drawBuffers.push_back(GLenum(GL_COLOR_ATTACHMENT0 + i));
+	}
+	glNamedFramebufferDrawBuffers(compiled.FBO, GLsizei(drawBuffers.size()), drawBuffers.data());
+	compiled.Attached = std::move(textures);
+	GLenum status = glCheckNamedFramebufferStatus(compiled.FBO, GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		LogError("RenderGraph: Framebuffer of pass ", pass.Name, " is incomplete: ", status);
+}
+
+void RenderGraph::Execute()
+{
+	if (Dirty)
+		Compile();
+	auto& state = GetGLState();
+	state.BindStorageBuffers(0, StorageBuffers);
+	for (size_t i = 0; i < Passes.size(); ++i)
+	{
+		auto& pass = Passes[i];
+		auto& compiled = Compiled[i];
+		if (pass.Compute)
+		{
+			ExecuteCompute(pass);
+			continue;
+		}
+		UpdateAttachments(pass, compiled);
+		auto& target = Resources[pass.Outputs.front()];
+		state.BindFramebuffer(compiled.FBO);
+		state.Viewport(0, 0, target.Width, target.Height);
+		if (pass.ClearOutputs)
+		{
+			const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (GLint j = 0; j < GLint(pass.Outputs.size()); ++j)
+				glClearNamedFramebufferfv(compiled.FBO, GL_COLOR, j, clearColor);
+		}
+		state.UseProgram(pass.Program);
+		for (GLuint unit = 0; unit < pass.Inputs.size(); ++unit)
+			state.BindTextureUnit(unit, Resources[pass.Inputs[unit]].Texture);
+		state.BindVertexArray(pass.VAO ? pass.VAO : EmptyVAO);
+		glDrawArrays(GL_TRIANGLES, 0, pass.VertexCount);
+	}
+}
+
+// Changes in a sequence of bindings repeated every frame, the last one carrying over to the first
+static uint64_t CountCyclicChanges(std::vector<GLuint> const& bindings)
+{
+	uint64_t changes = 0;
+	for (size_t i = 0; i < bindings.size(); ++i)
+		changes += bindings[i] != bindings[(i + bindings.size() - 1) % bindings.size()];
+	return changes;
+}
+
+GLBindCounts RenderGraph::GetSteadyStateBinds() const
+{
+	// Compute passes leave the framebuffer and vertex array alone
+	std::vector<GLuint> framebuffers, programs, vertexArrays;
+	for (size_t i = 0; i < Passes.size(); ++i)
+	{
+		auto& pass = Passes[i];
+		programs.push_back(pass.Program);
+		if (pass.Compute)
+			continue;
+		framebuffers.push_back(Compiled[i].FBO);
+		vertexArrays.push_back(pass.VAO ? pass.VAO : EmptyVAO);
+	}
+	return { .Framebuffer = CountCyclicChanges(framebuffers), .Program = CountCyclicChanges(programs), .VertexArray = CountCyclicChanges(vertexArrays) };
+}
+
+void RenderGraph::ExecuteCompute(RenderPass const& pass)
+{
+	auto& target = Resources[pass.Outputs.front()];
+	auto& state = GetGLState();
+	state.UseProgram(pass.Program);
+	for (GLuint unit = 0; unit < pass.Inputs.size(); ++unit)
+		state.BindTextureUnit(unit, Resources[pass.Inputs[unit]].Texture);
+	for (GLuint unit = 0; unit < pass.Outputs.size(); ++unit)
+	{
+		auto& output = Resources[pass.Outputs[unit]];
+		state.BindImageTexture(unit, output.Texture, output.Format);
+	}
+	glDispatchCompute((target.Width + 7) / 8, (target.Height + 7) / 8, 1);
+	// Image stores are incoherent, make them visible to later passes, readbacks and Nodos alike
+	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "GLState.h"
+
+struct TextureDesc
+{
+	GLenum Format = GL_NONE;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	bool operator==(TextureDesc const& other) const = default;
+};
+
+struct TextureDescHash
+{
+	size_t operator()(TextureDesc const& desc) const
+	{
+		return std::hash<uint64_t>{}((uint64_t(desc.Format) << 40) ^ (uint64_t(desc.Width) << 20) ^ desc.Height);
+	}
+};
+
+// Owns GL textures used as transient render targets. Released textures are kept around and handed out again
+// to the next request with the same format and size, so steady-state rendering never allocates GPU memory.
+class TexturePool
+{
+public:
+	TexturePool() = default;
+	TexturePool(TexturePool const&) = delete;
+	TexturePool& operator=(TexturePool const&) = delete;
+	~TexturePool();
+
+	GLuint Acquire(TextureDesc const& desc);
+	void Release(GLuint texture);
+	// Deletes every texture that is not currently acquired
+	void Trim();
+	void Clear();
+
+	size_t GetTextureCount() const { return Descs.size(); }
+	// Estimated video memory of every texture, acquired or not
+	uint64_t GetByteCount() const { return Bytes; }
+private:
+	std::unordered_map<TextureDesc, std::vector<GLuint>, TextureDescHash> Free;
+	std::unordered_map<GLuint, TextureDesc> Descs;
+	uint64_t Bytes = 0;
+};
+
+using ResourceId = uint32_t;
+constexpr ResourceId INVALID_RESOURCE = ~0u;
+
+struct RenderPass
+{
+	std::string Name;
+	GLuint Program = 0;
+	// Vertex array to draw with, 0 uses an empty one (for shaders generating a fullscreen triangle from gl_VertexID)
+	GLuint VAO = 0;
+	GLsizei VertexCount = 3;
+	// Clear outputs to transparent black before drawing, for passes that do not cover the whole target
+	bool ClearOutputs = false;
+	// Dispatches Program as a compute shader with one invocation per texel of the first output, in 8x8 groups.
+	// Outputs are bound to image units in declaration order instead of being attached.
+	bool Compute = false;
+	// Bound to texture units in declaration order
+	std::vector<ResourceId> Inputs;
+	// Attached as color attachments in declaration order
+	std::vector<ResourceId> Outputs;
+};
+
+// An ordered list of passes reading and writing named textures.
+// External resources are owned by the caller and bound every frame, transient ones are allocated from a TexturePool
+// when the graph is compiled. Transients whose lifetimes do not overlap share the same texture.
+class RenderGraph
+{
+public:
+	RenderGraph() = default;
+	RenderGraph(RenderGraph const&) = delete;
+	RenderGraph& operator=(RenderGraph const&) = delete;
+	~RenderGraph();
+
+	ResourceId AddExternal(std::string name);
+	// Transient texture with the size of another resource, scaled by scale
+	ResourceId AddTransient(std::string name, GLenum format, ResourceId sizeSource, float scale = 1.0f);
+	ResourceId AddTransient(std::string name, GLenum format, ResourceId sizeSource, float scaleX, float scaleY);
+	// Like AddTransient, further scaled by the dynamic scale. Transients sized after it inherit the scale.
+	ResourceId AddDynamicTransient(std::string name, GLenum format, ResourceId sizeSource, float scaleX = 1.0f, float scaleY = 1.0f);
+	void AddPass(RenderPass pass);
+	// Deletes every GL object owned by the graph except pooled textures, must be called while the context is current
+	void Clear();
+
+	// format is only needed for externals written by compute passes
+	void SetExternal(ResourceId id, GLuint texture, uint32_t width, uint32_t height, GLenum format = GL_NONE);
+	// Bound to shader storage binding points 0.. for every pass, 0 leaves a binding point empty
+	void SetStorageBuffers(std::vector<GLuint> buffers) { StorageBuffers = std::move(buffers); }
+	bool IsReady() const;
+	void Execute();
+	// Resizes dynamic transients on the next Execute, textures of the previous size go back to the pool
+	void SetDynamicScale(float scale);
+	float GetDynamicScale() const { return DynamicScale; }
+
+	size_t GetPassCount() const { return Passes.size(); }
+	// Times Execute had to compile the graph, which changes the textures passes are bound to
+	uint64_t GetCompileCount() const { return CompileCount; }
+	// Binds one more Execute issues when the bindings left by the previous one are still current,
+	// valid once the compiled graph has been executed
+	GLBindCounts GetSteadyStateBinds() const;
+	TexturePool& GetPool() { return Pool; }
+private:
+	struct Resource
+	{
+		std::string Name;
+		bool External = false;
+		bool Dynamic = false;
+		GLenum Format = GL_NONE;
+		ResourceId SizeSource = INVALID_RESOURCE;
+		float ScaleX = 1.0f;
+		float ScaleY = 1.0f;
+		GLuint Texture = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+	struct CompiledPass
+	{
+		GLuint FBO = 0;
+		std::vector<GLuint> Attached;
+	};
+
+	void Compile();
+	void ReleaseTransients();
+	void UpdateAttachments(RenderPass const& pass, CompiledPass& compiled);
+	void ExecuteCompute(RenderPass const& pass);
+
+	std::vector<Resource> Resources;
+	std::vector<RenderPass> Passes;
+	std::vector<CompiledPass> Compiled;
+	// Distinct pool textures backing the transients of the compiled graph
+	std::vector<GLuint> Held;
+	TexturePool Pool;
+	std::vector<GLuint> StorageBuffers;
+	GLuint EmptyVAO = 0;
+	float DynamicScale = 1.0f;
+	uint64_t CompileCount = 0;
+	bool Dirty = true;
+};
@@ -0,0 +1,120 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#if defined(NDEBUG)
+constexpr bool TrackOwners = false;
+#else
+constexpr bool TrackOwners = true;
+#endif
+
+static char const* const KindNames[TrackedKindCount] = { "OS handles", "memory objects", "textures", "buffers", "semaphores" };
+
+static std::array<std::atomic<int64_t>, TrackedKindCount> LiveCounts;
+
+struct TrackedObject
+{
+	char const* Owner;
+	std::chrono::steady_clock::time_point Created;
+};
+
+static std::mutex TrackedMutex;
+static std::array<std::unordered_map<uint64_t, TrackedObject>, TrackedKindCount> Tracked;
+
+void TrackResource(TrackedKind kind, uint64_t id, char const* owner)
+{
+	if (!id)
+		return;
+	LiveCounts[size_t(kind)].fetch_add(1, std::memory_order_relaxed);
+	if constexpr (!TrackOwners)
+		return;
+	std::unique_lock lock(TrackedMutex);
+	auto [it, inserted] = Tracked[size_t(kind)].try_emplace(id, TrackedObject{ owner, std::chrono::steady_clock::now() });
+	if (inserted)
+		return;
+	// The id was handed out again, so the previous object was deleted without being untracked
+	LogError("Resources: ", KindNames[size_t(kind)], " ", id, " of ", owner, " is already tracked for ", it->second.Owner, ", it was released untracked");
+	it->second = { owner, std::chrono::steady_clock::now() };
+	LiveCounts[size_t(kind)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+void UntrackResource(TrackedKind kind, uint64_t id)
+{
+	if (!id)
+		return;
+	if constexpr (TrackOwners)
+	{
+		std::unique_lock lock(TrackedMutex);
+		if (!Tracked[size_t(kind)].erase(id))
+		{
+			LogError("Resources: ", KindNames[size_t(kind)], " ", id, " released but not live, double free or created untracked");
+			return;
+		}
+	}
+	LiveCounts[size_t(kind)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint64_t GetLiveResourceCount(TrackedKind kind)
+{
+	return uint64_t(std::max<int64_t>(LiveCounts[size_t(kind)].load(std::memory_order_relaxed), 0));
+}
+
+// Live objects of one kind grouped by owner, with the creation time of the oldest
+static std::map<std::string_view, std::pair<uint64_t, std::chrono::steady_clock::time_point>> GroupByOwner(TrackedKind kind)
+{
+	std::map<std::string_view, std::pair<uint64_t, std::chrono::steady_clock::time_point>> owners;
+	std::unique_lock lock(TrackedMutex);
+	for (auto& [id, object] : Tracked[size_t(kind)])
+	{
+		auto [it, inserted] = owners.try_emplace(object.Owner, 0, object.Created);
+		it->second.first++;
+		it->second.second = std::min(it->second.second, object.Created);
+	}
+	return owners;
+}
+
+static void LogOwners(LogSeverity severity, TrackedKind kind, char const* state)
+{
+	auto now = std::chrono::steady_clock::now();
+	for (auto& [owner, group] : GroupByOwner(kind))
+	{
+		auto age = std::chrono::duration_cast<std::chrono::seconds>(now - group.second).count();
+		// Keyed by owner so the rate limit never hides one owner behind another
+		LogWithKey(severity, uint64_t(uintptr_t(owner.data())) + uint64_t(kind), "Resources: ", group.first, " ", KindNames[size_t(kind)], " ", state, " for ", owner, ", oldest ", age, " s old");
+	}
+}
+
+void LogLiveResources(LogSeverity severity)
+{
+	if (!IsLogged(severity))
+		return;
+	Log(severity, "Resources live: ", GetLiveResourceCount(TrackedKind::OSHandle), " OS handles, ", GetLiveResourceCount(TrackedKind::MemoryObject), " memory objects, ",
+		GetLiveResourceCount(TrackedKind::Texture), " textures, ", GetLiveResourceCount(TrackedKind::Buffer), " buffers, ", GetLiveResourceCount(TrackedKind::Semaphore), " semaphores");
+	if constexpr (TrackOwners)
+		for (size_t kind = 0; kind < TrackedKindCount; ++kind)
+			LogOwners(severity, TrackedKind(kind), "live");
+}
+
+void CheckResourceLeaks()
+{
+	for (size_t kind = 0; kind < TrackedKindCount; ++kind)
+	{
+		if (!GetLiveResourceCount(TrackedKind(kind)))
+			continue;
+		if constexpr (TrackOwners)
+			LogOwners(LogSeverity::Warning, TrackedKind(kind), "leaked");
+		else
+			LogWarning("Resources: ", GetLiveResourceCount(TrackedKind(kind)), " ", KindNames[kind], " leaked");
+	}
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Log.h"
+
+enum class TrackedKind : uint8_t
+{
+	OSHandle,
+	MemoryObject,
+	Texture,
+	Buffer,
+	Semaphore,
+};
+constexpr size_t TrackedKindCount = 5;
+
+// Every OS handle duplicated from Nodos and every GL object created for pins or render targets is tracked from creation
+// to deletion, so live counts show what a long-running process accumulates. Debug builds also remember the owner and
+// creation time of each object, report objects tracked twice or deleted while not live, and list leaks at exit.
+// owner must be a string literal. Ids of 0 are ignored.
+void TrackResource(TrackedKind kind, uint64_t id, char const* owner);
+void UntrackResource(TrackedKind kind, uint64_t id);
+uint64_t GetLiveResourceCount(TrackedKind kind);
+// Logs the live count of every kind, debug builds add each owner's count and oldest object
+void LogLiveResources(LogSeverity severity);
+// Call once everything should be released, logs whatever is still live as leaked
+void CheckResourceLeaks();
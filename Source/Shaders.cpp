@@ -0,0 +1,445 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Shaders.h"
+#include "Log.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+static GLuint CompileShader(const char* shaderSource, GLenum shaderType)
+{
+	GLuint shader = glCreateShader(shaderType);
+	glShaderSource(shader, 1, &shaderSource, nullptr);
+	glCompileShader(shader);
+
+	GLint success;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		GLint max_length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &max_length);
+
+		// The maxLength includes the NULL character
+		std::vector<GLchar> error_log(max_length);
+		glGetShaderInfoLog(shader, max_length, &max_length, &error_log[0]);
+		std::string str_error;
+		str_error.insert(str_error.end(), error_log.begin(), error_log.end());
+
+		// Provide the infolog in whatever manor you deem best.
+		// Exit with failure.
+		glDeleteShader(shader);        // Don't leak the shader.
+		LogError("OpenGL: Shader compilation failed", str_error);
+		return 0;
+	}
+	return shader;
+}
+
+GLuint CreateShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource)
+{
+	GLuint shaderProgram = glCreateProgram();
+	auto vertexShader = CompileShader(vertexShaderSource, GL_VERTEX_SHADER);
+	auto fragmentShader = CompileShader(fragmentShaderSource, GL_FRAGMENT_SHADER);
+	glAttachShader(shaderProgram, vertexShader);
+	glAttachShader(shaderProgram, fragmentShader);
+	glLinkProgram(shaderProgram);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	return shaderProgram;
+}
+
+GLuint CreateComputeProgram(const char* computeShaderSource)
+{
+	GLuint shaderProgram = glCreateProgram();
+	auto computeShader = CompileShader(computeShaderSource, GL_COMPUTE_SHADER);
+	glAttachShader(shaderProgram, computeShader);
+	glLinkProgram(shaderProgram);
+	glDeleteShader(computeShader);
+	return shaderProgram;
+}
+
+// Graph passes render with an upper-left origin, so texCoord.y has to grow with the row written, as the image
+// coordinates of compute passes do. Otherwise every effect pass would flip the image.
+static const char* FullscreenVertexShader = R"(
+	#version 450
+
+	out vec2 texCoord;
+	void main()
+	{
+		vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+		texCoord = vec2(pos.x, 1.0 - pos.y);
+		gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+	}
+)";
+
+// Each effect defines Effect(texCoord) reading inTexture, so it can be wrapped in a fragment shader or fused into a compute pass
+struct EffectSource
+{
+	std::string_view Name;
+	const char* Source;
+	uint32_t BufferCount = 0;
+};
+
+static const EffectSource Effects[] = {
+	{ "copy", R"(
+		vec4 Effect(vec2 texCoord)
+		{
+			return texture(inTexture, texCoord);
+		}
+	)" },
+	{ "blur", R"(
+		vec4 Effect(vec2 texCoord)
+		{
+			// 3x3 gaussian, taps placed between texels so bilinear filtering does the weighting
+			vec2 texel = 1.0 / vec2(textureSize(inTexture, 0));
+			vec4 sum = texture(inTexture, texCoord + texel * vec2(-0.5, -0.5))
+				+ texture(inTexture, texCoord + texel * vec2(0.5, -0.5))
+				+ texture(inTexture, texCoord + texel * vec2(-0.5, 0.5))
+				+ texture(inTexture, texCoord + texel * vec2(0.5, 0.5));
+			return sum * 0.25;
+		}
+	)" },
+	{ "grade", R"(
+		const vec3 Lift = vec3(0.02, 0.0, -0.02);
+		const vec3 Gamma = vec3(1.0, 1.0, 1.05);
+		const vec3 Gain = vec3(1.05, 1.0, 0.95);
+		const float Saturation = 1.1;
+		vec4 Effect(vec2 texCoord)
+		{
+			vec4 color = texture(inTexture, texCoord);
+			vec3 graded = pow(max(color.rgb * Gain + Lift, 0.0), 1.0 / Gamma);
+			float luma = dot(graded, vec3(0.2126, 0.7152, 0.0722));
+			return vec4(mix(vec3(luma), graded, Saturation), color.a);
+		}
+	)" },
+	{ "sharpen", R"(
+		const float Amount = 0.5;
+		vec4 Effect(vec2 texCoord)
+		{
+			ivec2 size = textureSize(inTexture, 0);
+			ivec2 p = ivec2(texCoord * vec2(size));
+			ivec2 maxP = size - 1;
+			vec4 center = texelFetch(inTexture, p, 0);
+			vec4 neighbours = texelFetch(inTexture, clamp(p + ivec2(1, 0), ivec2(0), maxP), 0)
+				+ texelFetch(inTexture, clamp(p - ivec2(1, 0), ivec2(0), maxP), 0)
+				+ texelFetch(inTexture, clamp(p + ivec2(0, 1), ivec2(0), maxP), 0)
+				+ texelFetch(inTexture, clamp(p - ivec2(0, 1), ivec2(0), maxP), 0);
+			return vec4(center.rgb + (center.rgb - neighbours.rgb * 0.25) * Amount, center.a);
+		}
+	)" },
+	{ "markers", R"(
+		// Tracking data from buffer input 0, one (x, y, radius, unused) per marker with x, y in texture coordinates and radius in pixels
+		layout(std430, binding = 0) readonly buffer Markers { vec4 markers[]; };
+		const int MaxMarkers = 1024;
+		vec4 Effect(vec2 texCoord)
+		{
+			vec4 color = texture(inTexture, texCoord);
+			vec2 size = vec2(textureSize(inTexture, 0));
+			int count = min(markers.length(), MaxMarkers);
+			for (int i = 0; i < count; ++i)
+			{
+				float d = distance(texCoord * size, markers[i].xy * size);
+				float ring = 1.0 - smoothstep(1.0, 2.0, abs(d - markers[i].z));
+				color.rgb = mix(color.rgb, vec3(1.0, 0.2, 0.2), ring * step(0.5, markers[i].z));
+			}
+			return color;
+		}
+	)", 1 },
+};
+
+static const char* EffectFragmentHeader = R"(
+	#version 450 core
+	in vec2 texCoord;
+	layout(binding = 0) uniform sampler2D inTexture;
+)";
+
+static const char* SampleVertexShader = R"(
+	#version 450
+
+	layout(location = 0) in vec3 aPos;
+	layout(location = 1) in vec2 aTexCoord;
+
+	out vec2 texCoord;
+	void main ()
+	{
+	  gl_Position = vec4(aPos, 1.0);
+	  texCoord = vec2(aTexCoord);
+	}
+)";
+
+// Piecewise sRGB transfer functions for formats that emulate sRGB, applied to color channels only
+static const char* SRGBFunctions = R"(
+	vec4 DecodeSRGB(vec4 c)
+	{
+		vec3 v = max(c.rgb, 0.0);
+		return vec4(mix(v / 12.92, pow((v + 0.055) / 1.055, vec3(2.4)), greaterThan(v, vec3(0.04045))), c.a);
+	}
+	vec4 EncodeSRGB(vec4 c)
+	{
+		vec3 v = max(c.rgb, 0.0);
+		return vec4(mix(v * 12.92, 1.055 * pow(v, vec3(1.0 / 2.4)) - 0.055, greaterThan(v, vec3(0.0031308))), c.a);
+	}
+)";
+
+static std::string GetIntegerMax(FormatInfo const& format)
+{
+	return std::to_string(format.IntegerMax) + ".0";
+}
+
+static std::string DeclareOutput(uint32_t location, FormatInfo const& format)
+{
+	const char* type = format.Type == ChannelType::UInt ? "uvec4" : format.Type == ChannelType::SInt ? "ivec4" : "vec4";
+	return "layout(location = " + std::to_string(location) + ") out " + type + " FragColor" + std::to_string(location) + ";\n";
+}
+
+static std::string WriteOutput(uint32_t location, std::string const& color, FormatInfo const& format)
+{
+	std::string value = "(" + color + ")";
+	if (format.EmulatesSRGB)
+		value = "EncodeSRGB(" + color + ")";
+	else if (format.Type == ChannelType::UInt)
+		value = "uvec4(clamp(" + color + ", 0.0, 1.0) * " + GetIntegerMax(format) + ")";
+	else if (format.Type == ChannelType::SInt)
+		value = "ivec4(clamp(" + color + ", -1.0, 1.0) * " + GetIntegerMax(format) + ")";
+	if (format.HasSwizzle())
+		value += "." + GetSwizzleSuffix(format);
+	return "\tFragColor" + std::to_string(location) + " = " + value + ";\n";
+}
+
+static std::string DeclareInput(uint32_t binding, SampledInput const& input)
+{
+	auto& format = input.Format;
+	const char* prefix = format.Type == ChannelType::UInt ? "u" : format.Type == ChannelType::SInt ? "i" : "";
+	const char* type = input.Target == GL_TEXTURE_3D ? "sampler3D" : input.Target == GL_TEXTURE_2D_ARRAY ? "sampler2DArray" : "sampler2D";
+	return "layout(binding = " + std::to_string(binding) + ") uniform " + prefix + type + " inTexture" + std::to_string(binding) + ";\n";
+}
+
+// Integer textures can't be filtered, they are fetched at the nearest texel.
+// Emulated sRGB is decoded after filtering, which is close enough for the smooth mattes these formats carry.
+static std::string ReadInput(uint32_t binding, SampledInput const& input)
+{
+	auto& format = input.Format;
+	std::string name = "inTexture" + std::to_string(binding);
+	std::string coord = input.Target == GL_TEXTURE_3D ? "vec3(uv, 0.5)" : input.Target == GL_TEXTURE_2D_ARRAY ? "vec3(uv, 0.0)" : "uv";
+	if (format.EmulatesSRGB)
+		return "DecodeSRGB(texture(" + name + ", " + coord + "))";
+	if (!format.IsInteger())
+		return "texture(" + name + ", " + coord + ")";
+	std::string size = "textureSize(" + name + ", 0)";
+	std::string texel = "ivec2(uv * vec2(" + size + ".xy))";
+	if (input.Target == GL_TEXTURE_3D)
+		texel = "ivec3(" + texel + ", " + size + ".z / 2)";
+	else if (input.Target == GL_TEXTURE_2D_ARRAY)
+		texel = "ivec3(" + texel + ", 0)";
+	return "vec4(texelFetch(" + name + ", " + texel + ", 0)) / " + GetIntegerMax(format);
+}
+
+// BT.709 limited range, as carried over SDI
+static const char* YCbCrFunctions = R"(
+	vec3 ToRGB(float y, vec2 cbcr)
+	{
+		float l = (y * 255.0 - 16.0) / 219.0;
+		vec2 c = (cbcr * 255.0 - 128.0) / 224.0;
+		return vec3(l + 1.5748 * c.y, l - 0.1873 * c.x - 0.4681 * c.y, l + 1.8556 * c.x);
+	}
+	vec3 ToYCbCr(vec3 rgb)
+	{
+		float l = dot(rgb, vec3(0.2126, 0.7152, 0.0722));
+		vec2 c = vec2((rgb.b - l) / 1.8556, (rgb.r - l) / 1.5748);
+		return clamp(vec3(l * 219.0 + 16.0, c * 224.0 + 128.0) / 255.0, 0.0, 1.0);
+	}
+)";
+
+// One invocation per output pixel. Chroma is co-sited with the even pixel and interpolated for the odd one.
+static const char* UnpackMain = R"(
+	layout(local_size_x = 8, local_size_y = 8) in;
+	layout(binding = 0) uniform sampler2D packedTexture;
+	layout(binding = 0, rgba16f) uniform writeonly image2D outImage;
+	// (Y0, Cb, Y1, Cr)
+	vec4 Macropixel(ivec2 p)
+	{
+		vec4 texel = texelFetch(packedTexture, clamp(p, ivec2(0), textureSize(packedTexture, 0) - 1), 0);
+	#ifdef UYVY
+		return texel.grab;
+	#else
+		return texel;
+	#endif
+	}
+	void main()
+	{
+		ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+		if (any(greaterThanEqual(p, imageSize(outImage))))
+			return;
+		vec4 m = Macropixel(ivec2(p.x / 2, p.y));
+		bool odd = (p.x & 1) == 1;
+		vec2 cbcr = odd ? (m.yw + Macropixel(ivec2(p.x / 2 + 1, p.y)).yw) * 0.5 : m.yw;
+		imageStore(outImage, p, vec4(ToRGB(odd ? m.z : m.x, cbcr), 1.0));
+	}
+)";
+
+// One invocation per output macropixel, evaluating Effect for both of its pixels
+static const char* PackMain = R"(
+	layout(local_size_x = 8, local_size_y = 8) in;
+	layout(binding = 0, rgba8) uniform writeonly image2D packedImage;
+	void main()
+	{
+		ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+		if (any(greaterThanEqual(p, imageSize(packedImage))))
+			return;
+		// Texel of the unpacked image, inputs rendered at a lower resolution are upsampled by the bilinear filter
+		vec2 texel = 1.0 / vec2(imageSize(packedImage) * ivec2(2, 1));
+		vec3 first = ToYCbCr(Effect((vec2(p.x * 2, p.y) + 0.5) * texel).rgb);
+		vec3 second = ToYCbCr(Effect((vec2(p.x * 2 + 1, p.y) + 0.5) * texel).rgb);
+		vec2 cbcr = (first.yz + second.yz) * 0.5;
+	#ifdef UYVY
+		imageStore(packedImage, p, vec4(cbcr.x, first.x, cbcr.y, second.x));
+	#else
+		imageStore(packedImage, p, vec4(first.x, cbcr.x, second.x, cbcr.y));
+	#endif
+	}
+)";
+
+// One invocation per preview texel, averaging up to 4x4 evenly spaced texels of the block it covers
+static const char* PreviewDownscaleSource = R"(
+	#version 450 core
+	layout(local_size_x = 8, local_size_y = 8) in;
+	layout(binding = 0) uniform sampler2D source;
+	layout(binding = 0, rgba8) uniform writeonly image2D preview;
+	void main()
+	{
+		ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+		ivec2 previewSize = imageSize(preview);
+		if (any(greaterThanEqual(p, previewSize)))
+			return;
+		ivec2 sourceSize = textureSize(source, 0);
+		ivec2 factor = (sourceSize + previewSize - 1) / previewSize;
+		ivec2 stride = max(factor / 4, ivec2(1));
+		vec4 sum = vec4(0.0);
+		float count = 0.0;
+		for (int y = 0; y < factor.y; y += stride.y)
+		{
+			for (int x = 0; x < factor.x; x += stride.x)
+			{
+				sum += texelFetch(source, min(p * factor + ivec2(x, y), sourceSize - 1), 0);
+				count += 1.0;
+			}
+		}
+		imageStore(preview, p, sum / count);
+	}
+)";
+
+static const EffectSource* FindEffect(std::string_view name)
+{
+	for (auto& effect : Effects)
+		if (effect.Name == name)
+			return &effect;
+	return nullptr;
+}
+
+bool IsKnownEffect(std::string_view name)
+{
+	return FindEffect(name) != nullptr;
+}
+
+uint32_t GetEffectBufferCount(std::string_view name)
+{
+	auto effect = FindEffect(name);
+	return effect ? effect->BufferCount : 0;
+}
+
+static std::unordered_map<std::string, GLuint> EffectPrograms;
+static std::mutex EffectProgramsMutex;
+
+GLuint GetEffectProgram(std::string_view name, FormatInfo const& output)
+{
+	auto effect = FindEffect(name);
+	if (!effect)
+	{
+		LogError("Unknown effect: ", name);
+		return 0;
+	}
+	std::string source = std::string(EffectFragmentHeader) + DeclareOutput(0, output) + SRGBFunctions + effect->Source
+		+ "void main()\n{\n" + WriteOutput(0, "Effect(texCoord)", output) + "}\n";
+	// Variants differ only in the generated lines, so the source is the key
+	std::unique_lock lock(EffectProgramsMutex);
+	auto it = EffectPrograms.find(source);
+	if (it != EffectPrograms.end())
+		return it->second;
+	return EffectPrograms[source] = CreateShaderProgram(FullscreenVertexShader, source.c_str());
+}
+
+GLuint GetSampleProgram(std::span<SampledInput const> inputs, std::span<FormatInfo const> outputs)
+{
+	std::string source = "#version 450 core\nin vec2 texCoord;\n";
+	for (uint32_t i = 0; i < inputs.size(); ++i)
+		source += DeclareInput(i, inputs[i]);
+	for (uint32_t o = 0; o < outputs.size(); ++o)
+		source += DeclareOutput(o, outputs[o]);
+	source += SRGBFunctions;
+	source += "void main()\n{\n\tvec2 uv = vec2(texCoord.x, 1-texCoord.y);\n";
+	for (uint32_t o = 0; o < outputs.size(); ++o)
+	{
+		uint32_t i = o % uint32_t(inputs.size());
+		source += WriteOutput(o, ReadInput(i, inputs[i]), outputs[o]);
+	}
+	source += "}\n";
+	std::unique_lock lock(EffectProgramsMutex);
+	auto it = EffectPrograms.find(source);
+	if (it != EffectPrograms.end())
+		return it->second;
+	return EffectPrograms[source] = CreateShaderProgram(SampleVertexShader, source.c_str());
+}
+
+static const char* GetPackingDefine(PixelPacking packing)
+{
+	return packing == PixelPacking::UYVY422 ? "#define UYVY\n" : "";
+}
+
+GLuint GetUnpackProgram(PixelPacking packing)
+{
+	std::string key = std::string("unpack ") + GetPackingDefine(packing);
+	std::unique_lock lock(EffectProgramsMutex);
+	auto it = EffectPrograms.find(key);
+	if (it != EffectPrograms.end())
+		return it->second;
+	std::string source = std::string("#version 450 core\n") + GetPackingDefine(packing) + YCbCrFunctions + UnpackMain;
+	return EffectPrograms[key] = CreateComputeProgram(source.c_str());
+}
+
+GLuint GetPackProgram(PixelPacking packing, std::string_view fusedEffect)
+{
+	std::string key = std::string("pack ") + GetPackingDefine(packing) + std::string(fusedEffect);
+	std::unique_lock lock(EffectProgramsMutex);
+	auto it = EffectPrograms.find(key);
+	if (it != EffectPrograms.end())
+		return it->second;
+	auto effect = FindEffect(fusedEffect.empty() ? "copy" : fusedEffect);
+	if (!effect)
+	{
+		LogError("Unknown effect: ", fusedEffect);
+		return 0;
+	}
+	std::string source = std::string("#version 450 core\n") + GetPackingDefine(packing)
+		+ "layout(binding = 0) uniform sampler2D inTexture;\n" + YCbCrFunctions + effect->Source + PackMain;
+	return EffectPrograms[key] = CreateComputeProgram(source.c_str());
+}
+
+GLuint GetPreviewProgram()
+{
+	std::unique_lock lock(EffectProgramsMutex);
+	auto it = EffectPrograms.find("preview");
+	if (it != EffectPrograms.end())
+		return it->second;
+	return EffectPrograms["preview"] = CreateComputeProgram(PreviewDownscaleSource);
+}
+
+void ClearShaderCache()
+{
+	std::unique_lock lock(EffectProgramsMutex);
+	for (auto& [name, program] : EffectPrograms)
+		glDeleteProgram(program);
+	EffectPrograms.clear();
+}
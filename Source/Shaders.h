@@ -0,0 +1,40 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <string_view>
+#include <span>
+
+#include <glad/glad.h>
+
+#include "Formats.h"
+
+GLuint CreateShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+GLuint CreateComputeProgram(const char* computeShaderSource);
+
+// Built-in effects that can be chained with --effects. Each reads texture unit 0 and writes color attachment 0,
+// drawing a fullscreen triangle without any vertex attributes.
+bool IsKnownEffect(std::string_view name);
+// Buffer inputs an effect reads from SSBO binding points 0.., which must be connected for it to run
+uint32_t GetEffectBufferCount(std::string_view name);
+// Programs are compiled once per variant and shared by every instance, safe to call from any thread with a shared context current.
+// Variants follow the render target's format: integer targets get converted colors, BGR-ordered ones reordered colors.
+GLuint GetEffectProgram(std::string_view name, FormatInfo const& output);
+struct SampledInput
+{
+	FormatInfo Format;
+	// Arrays are sampled at layer 0 and volumes at their middle slice
+	GLenum Target = GL_TEXTURE_2D;
+};
+// Sample pass writing output i from input (i % input count), all outputs in a single draw with the shared triangle VBO.
+// Integer inputs are read with texelFetch and normalized, outputs are written like effect outputs.
+GLuint GetSampleProgram(std::span<SampledInput const> inputs, std::span<FormatInfo const> outputs);
+// Compute program unpacking texture unit 0 into image unit 0 (rgba16f, full width)
+GLuint GetUnpackProgram(PixelPacking packing);
+// Compute program evaluating fusedEffect (a plain copy if empty) on texture unit 0 and packing the result into image unit 0 (rgba8, half width)
+GLuint GetPackProgram(PixelPacking packing, std::string_view fusedEffect);
+// Compute program box-filtering texture unit 0 down into image unit 0 (rgba8), which must be at most as large
+GLuint GetPreviewProgram();
+void ClearShaderCache();
@@ -0,0 +1,262 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "Stats.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <optional>
+
+#if defined(_WIN32)
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include "Windows.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+void StatsSlot::Write(InstanceStats const& stats)
+{
+	uint64_t words[std::size(Words)];
+	memcpy(words, &stats, sizeof(words));
+	uint64_t sequence = Sequence.load(std::memory_order_relaxed);
+	// Odd while writing
+	Sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t i = 0; i < std::size(Words); ++i)
+		Words[i].store(words[i], std::memory_order_relaxed);
+	Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool StatsSlot::TryRead(InstanceStats& stats) const
+{
+	uint64_t before = Sequence.load(std::memory_order_acquire);
+	if (before & 1)
+		return false;
+	uint64_t words[std::size(Words)];
+	for (size_t i = 0; i < std::size(Words); ++i)
+		words[i] = Words[i].load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (Sequence.load(std::memory_order_relaxed) != before)
+		return false;
+	memcpy(&stats, words, sizeof(words));
+	return true;
+}
+
+#if defined(_WIN32)
+static std::string GetMappingName(std::string const& name)
+{
+	return "Local\\" + name;
+}
+#else
+static std::string GetMappingName(std::string const& name)
+{
+	return "/" + name;
+}
+#endif
+
+#if defined(_WIN32)
+static bool IsProcessAlive(uint32_t processId)
+{
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+	if (!process)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+	DWORD exitCode = 0;
+	bool alive = GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+	CloseHandle(process);
+	return alive;
+}
+#else
+static bool IsProcessAlive(uint32_t processId)
+{
+	// EPERM means the process exists but belongs to someone else
+	return kill(pid_t(processId), 0) == 0 || errno == EPERM;
+}
+
+// Process that created the segment at mappingName, if the segment has a complete header
+static std::optional<uint32_t> GetSegmentOwner(std::string const& mappingName)
+{
+	int fd = shm_open(mappingName.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+		return std::nullopt;
+	struct stat info{};
+	void* data = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(StatsSegment))
+		data = mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return std::nullopt;
+	auto segment = static_cast<StatsSegment const*>(data);
+	std::optional<uint32_t> owner;
+	if (segment->Magic == StatsMagic)
+		owner = segment->ProcessId;
+	munmap(data, sizeof(StatsSegment));
+	return owner;
+}
+#endif
+
+std::unique_ptr<StatsMapping> StatsMapping::Create(std::string const& name, uint32_t instanceCount)
+{
+	std::unique_ptr<StatsMapping> mapping(new StatsMapping());
+	mapping->Name = GetMappingName(name);
+	void* data = nullptr;
+#if defined(_WIN32)
+	mapping->Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(StatsSegment), mapping->Name.c_str());
+	if (!mapping->Mapping)
+	{
+		LogError("Failed to create stats segment ", name);
+		return nullptr;
+	}
+	bool existed = GetLastError() == ERROR_ALREADY_EXISTS;
+	data = MapViewOfFile(mapping->Mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(StatsSegment));
+	// Readers keep the mapping of an exited process alive, it is only reused once its owner is gone
+	if (data && existed)
+	{
+		auto segment = static_cast<StatsSegment const*>(data);
+		if (segment->Magic == StatsMagic && IsProcessAlive(segment->ProcessId))
+		{
+			LogError("Stats segment ", name, " is in use by process ", segment->ProcessId);
+			UnmapViewOfFile(data);
+			return nullptr;
+		}
+	}
+	DWORD processId = GetCurrentProcessId();
+#else
+	int fd = shm_open(mapping->Name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0 && errno == EEXIST)
+	{
+		if (auto owner = GetSegmentOwner(mapping->Name); owner && IsProcessAlive(*owner))
+		{
+			LogError("Stats segment ", name, " is in use by process ", *owner);
+			return nullptr;
+		}
+		// Left behind by a process that did not exit cleanly
+		LogWarning("Replacing stale stats segment ", name);
+		shm_unlink(mapping->Name.c_str());
+		fd = shm_open(mapping->Name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+	if (fd < 0)
+	{
+		LogError("Failed to create stats segment ", name);
+		return nullptr;
+	}
+	mapping->IsOwner = true;
+	if (ftruncate(fd, sizeof(StatsSegment)) == 0)
+		data = mmap(nullptr, sizeof(StatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		data = nullptr;
+	pid_t processId = getpid();
+#endif
+	if (!data)
+	{
+		LogError("Failed to map stats segment ", name);
+		return nullptr;
+	}
+	// The magic goes in last, readers that see it see the whole header
+	auto segment = new (data) StatsSegment{};
+	segment->Version = StatsVersion;
+	segment->ProcessId = uint32_t(processId);
+	segment->InstanceCount = std::min(instanceCount, MaxStatsInstances);
+	std::atomic_thread_fence(std::memory_order_release);
+	segment->Magic = StatsMagic;
+	mapping->Segment = segment;
+	return mapping;
+}
+
+std::unique_ptr<StatsMapping> StatsMapping::Open(std::string const& name)
+{
+	std::unique_ptr<StatsMapping> mapping(new StatsMapping());
+	mapping->Name = GetMappingName(name);
+	void* data = nullptr;
+#if defined(_WIN32)
+	mapping->Mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mapping->Name.c_str());
+	if (!mapping->Mapping)
+	{
+		LogError("No stats segment named ", name);
+		return nullptr;
+	}
+	data = MapViewOfFile(mapping->Mapping, FILE_MAP_READ, 0, 0, sizeof(StatsSegment));
+#else
+	int fd = shm_open(mapping->Name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		LogError("No stats segment named ", name);
+		return nullptr;
+	}
+	// Reading past the end of the object raises SIGBUS. It is empty until its creator sizes it, and smaller if an
+	// older layout created it.
+	struct stat info{};
+	if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(StatsSegment))
+	{
+		LogError("Stats segment ", name, " is not ready or has an older layout");
+		close(fd);
+		return nullptr;
+	}
+	data = mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		data = nullptr;
+#endif
+	if (!data)
+	{
+		LogError("Failed to map stats segment ", name);
+		return nullptr;
+	}
+	mapping->Segment = static_cast<StatsSegment*>(data);
+	if (mapping->Segment->Magic != StatsMagic)
+	{
+		LogError("Not a stats segment: ", name);
+		return nullptr;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (mapping->Segment->Version != StatsVersion)
+	{
+		LogError("Stats segment ", name, " has version ", mapping->Segment->Version, ", expected ", StatsVersion);
+		return nullptr;
+	}
+	return mapping;
+}
+
+StatsMapping::~StatsMapping()
+{
+#if defined(_WIN32)
+	if (Segment)
+		UnmapViewOfFile(Segment);
+	if (Mapping)
+		CloseHandle(Mapping);
+#else
+	if (Segment)
+		munmap(Segment, sizeof(StatsSegment));
+	if (IsOwner)
+		shm_unlink(Name.c_str());
+#endif
+}
+
+static std::unique_ptr<StatsMapping> PublishedStats;
+
+bool StartPublishingStats(std::string const& name, uint32_t instanceCount)
+{
+	PublishedStats = StatsMapping::Create(name, instanceCount);
+	return PublishedStats != nullptr;
+}
+
+void StopPublishingStats()
+{
+	PublishedStats.reset();
+}
+
+void PublishStats(uint32_t instanceIndex, InstanceStats const& stats)
+{
+	if (PublishedStats && instanceIndex < PublishedStats->Segment->InstanceCount)
+		PublishedStats->Segment->Instances[instanceIndex].Write(stats);
+}
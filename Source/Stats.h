@@ -0,0 +1,109 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Shared with the stats reader in Tools/, which may be built from a different revision.
+// Bump StatsVersion whenever the layout of anything below changes.
+constexpr uint32_t StatsMagic = 0x5354534E; // "NSTS"
+constexpr uint32_t StatsVersion = 6;
+constexpr uint32_t MaxStatsInstances = 16;
+
+// Counters of one instance, totals since the instance was created unless noted otherwise
+struct InstanceStats
+{
+	uint64_t RenderedFrames = 0;
+	// Frames Nodos started that could not be rendered, e.g. because waiting for the input semaphore failed
+	uint64_t FailedFrames = 0;
+	// Started frames passed over by --late-frames to render a later one
+	uint64_t SkippedFrames = 0;
+	// Next frame this instance renders
+	uint64_t CurFrameNumber = 0;
+	// Last frame Nodos started, 0 until the first one after a reset
+	uint64_t NodosFrameNumber = 0;
+	// Time the render thread slept waiting for Nodos to start a frame
+	uint64_t ExecutionWaitNanoseconds = 0;
+	// From Nodos starting a frame to the render thread seeing it, summed over the frame starts it saw
+	uint64_t FrameStartLatencyNanoseconds = 0;
+	uint64_t FrameStartsSeen = 0;
+	// GPU time spent waiting on the input semaphore, measured a few frames late, or CPU time spent waiting for the
+	// frame to complete without Nodos
+	uint64_t SemaphoreWaitNanoseconds = 0;
+	uint64_t TasksProcessed = 0;
+	// Tasks queued and not yet run when the stats were published
+	uint64_t TaskQueueDepth = 0;
+	uint64_t TexturesImported = 0;
+	uint64_t BuffersImported = 0;
+	uint64_t ImportFailures = 0;
+	// nos::app::ExecutionState
+	uint64_t ExecutionState = 0;
+	// Times the watchdog found no frame started within its timeout and resynchronized
+	uint64_t Stalls = 0;
+	// With --frame-budget: GPU time of the last measured frame and the resolution the effects render at
+	uint64_t GpuFrameMicroseconds = 0;
+	uint64_t ResolutionScalePercent = 100;
+	// Video memory held now: allocations imported for pins and render targets in the texture pool
+	uint64_t ImportedBytes = 0;
+	uint64_t PooledBytes = 0;
+	// Times an import over --memory-budget evicted pooled textures, and imports refused because that was not enough
+	uint64_t MemoryEvictions = 0;
+	uint64_t BudgetRejections = 0;
+};
+static_assert(sizeof(InstanceStats) % sizeof(uint64_t) == 0);
+
+// Seqlock around a copy of InstanceStats: one writer, any number of readers that never block it.
+// The words are atomics so readers racing with the writer read torn values instead of undefined ones, and retry.
+struct StatsSlot
+{
+	void Write(InstanceStats const& stats);
+	// Returns false if the writer was active, try again
+	bool TryRead(InstanceStats& stats) const;
+
+	std::atomic<uint64_t> Sequence;
+	std::atomic<uint64_t> Words[sizeof(InstanceStats) / sizeof(uint64_t)];
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Stats are shared between processes");
+
+struct StatsSegment
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t ProcessId;
+	uint32_t InstanceCount;
+	StatsSlot Instances[MaxStatsInstances];
+};
+
+// A named shared memory segment holding a StatsSegment, a POSIX shm object on Linux and a file mapping on Windows
+struct StatsMapping
+{
+	// Creates the segment, replacing a stale one left by a crashed process with the same name
+	static std::unique_ptr<StatsMapping> Create(std::string const& name, uint32_t instanceCount);
+	// Opens the segment of a running app read-only
+	static std::unique_ptr<StatsMapping> Open(std::string const& name);
+	StatsMapping(StatsMapping const&) = delete;
+	StatsMapping& operator=(StatsMapping const&) = delete;
+	~StatsMapping();
+
+	StatsSegment* Segment = nullptr;
+
+private:
+	StatsMapping() = default;
+	std::string Name;
+	bool IsOwner = false;
+#if defined(_WIN32)
+	void* Mapping = nullptr;
+#endif
+};
+
+// --stats NAME: the app publishes every instance's counters to the segment NAME
+bool StartPublishingStats(std::string const& name, uint32_t instanceCount);
+// Call once every instance is stopped
+void StopPublishingStats();
+// Does nothing unless publishing, instances past MaxStatsInstances are not published
+void PublishStats(uint32_t instanceIndex, InstanceStats const& stats);
@@ -0,0 +1,182 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#include "WakeEvent.h"
+#include "Log.h"
+
+#include <cmath>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include "Windows.h"
+#else
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+static void CpuRelax()
+{
+	_mm_pause();
+}
+#elif defined(__aarch64__)
+static void CpuRelax()
+{
+	asm volatile("yield");
+}
+#else
+static void CpuRelax()
+{
+}
+#endif
+
+void WakeEvent::Signal()
+{
+	// A spinning waiter sees the flag, only a sleeping one needs the kernel. Both sides use sequentially consistent
+	// operations, so either the waiter sees Pending before sleeping or this sees Sleeping.
+	Pending.store(true);
+	if (!Sleeping.load())
+		return;
+#if defined(_WIN32)
+	SetEvent(Event);
+#else
+	uint64_t one = 1;
+	// Only fails when the counter would overflow, which still leaves it readable
+	(void)!write(EventFd, &one, sizeof(one));
+#endif
+}
+
+bool WakeEvent::Wait(std::optional<std::chrono::nanoseconds> timeout)
+{
+	if (Pending.exchange(false))
+		return true;
+	Sleeping.store(true);
+	if (Pending.exchange(false))
+	{
+		Sleeping.store(false);
+		return true;
+	}
+	bool woken = Block(timeout);
+	Sleeping.store(false);
+	// A signal that saw Sleeping may have set Pending after the wait timed out; a stale wake-up left by one that raced
+	// with the check above only causes a spurious return, which callers recheck anyway
+	return Pending.exchange(false) || woken;
+}
+
+bool WakeEvent::Spin(std::chrono::steady_clock::time_point until)
+{
+	while (true)
+	{
+		if (Pending.load(std::memory_order_relaxed) && Pending.exchange(false))
+			return true;
+		if (std::chrono::steady_clock::now() >= until)
+			return false;
+		// Reading the clock costs more than a few pauses
+		for (int i = 0; i < 32; ++i)
+			CpuRelax();
+	}
+}
+
+#if defined(_WIN32)
+WakeEvent::WakeEvent()
+{
+	Event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+	if (!Event)
+		LogError("Failed to create wake-up event");
+}
+
+WakeEvent::~WakeEvent()
+{
+	if (Event)
+		CloseHandle(Event);
+}
+
+bool WakeEvent::Block(std::optional<std::chrono::nanoseconds> timeout)
+{
+	DWORD milliseconds = INFINITE;
+	if (timeout)
+		milliseconds = DWORD(std::chrono::ceil<std::chrono::milliseconds>(std::max(*timeout, std::chrono::nanoseconds(0))).count());
+	return WaitForSingleObject(Event, milliseconds) == WAIT_OBJECT_0;
+}
+#else
+WakeEvent::WakeEvent()
+{
+	EventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (EventFd < 0)
+		LogError("Failed to create wake-up eventfd");
+}
+
+WakeEvent::~WakeEvent()
+{
+	if (EventFd >= 0)
+		close(EventFd);
+}
+
+bool WakeEvent::Block(std::optional<std::chrono::nanoseconds> timeout)
+{
+	timespec time{};
+	if (timeout)
+	{
+		auto nanoseconds = std::max<int64_t>(timeout->count(), 0);
+		time.tv_sec = nanoseconds / 1000000000;
+		time.tv_nsec = nanoseconds % 1000000000;
+	}
+	pollfd fd{ .fd = EventFd, .events = POLLIN };
+	int ready;
+	do
+		ready = ppoll(&fd, 1, timeout ? &time : nullptr, nullptr);
+	while (ready < 0 && errno == EINTR);
+	if (ready <= 0)
+		return false;
+	// Reading resets the counter, coalescing every signal so far
+	uint64_t count;
+	return read(EventFd, &count, sizeof(count)) == sizeof(count);
+}
+#endif
+
+// Shortest distance the window reaches to either side, covers the clock and scheduling noise of perfectly regular starts
+constexpr double MinHalfWidth = 20000;
+
+void FrameStartPredictor::OnFrameStart(std::chrono::steady_clock::time_point start)
+{
+	auto last = std::exchange(LastStart, start);
+	if (!last || start <= *last)
+		return;
+	double sample = double(std::chrono::duration_cast<std::chrono::nanoseconds>(start - *last).count());
+	if (Interval == 0)
+	{
+		Interval = sample;
+		Deviation = sample / 2;
+		return;
+	}
+	// Pauses and missed frames say nothing about the pace
+	if (sample > Interval * 4)
+		return;
+	Deviation = Deviation * 0.75 + std::abs(sample - Interval) * 0.25;
+	Interval = Interval * 0.875 + sample * 0.125;
+}
+
+std::optional<SpinWindow> FrameStartPredictor::GetSpinWindow() const
+{
+	if (!LastStart || Interval == 0)
+		return std::nullopt;
+	double halfWidth = std::max(Deviation * 4, MinHalfWidth);
+	if (halfWidth > double(MaxHalfWidth.count()))
+		return std::nullopt;
+	auto predicted = *LastStart + std::chrono::nanoseconds(int64_t(Interval));
+	auto half = std::chrono::nanoseconds(int64_t(halfWidth));
+	return SpinWindow{ predicted - half, predicted + half };
+}
+
+void FrameStartPredictor::Reset()
+{
+	LastStart = std::nullopt;
+	Interval = 0;
+	Deviation = 0;
+}
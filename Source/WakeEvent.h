@@ -0,0 +1,106 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+// Between From and Until a waiter spins instead of sleeping, e.g. around the time the next frame is expected to start
+struct SpinWindow
+{
+	std::chrono::steady_clock::time_point From;
+	std::chrono::steady_clock::time_point Until;
+};
+
+// Wakes the one thread waiting on it from any thread, signals sent while nobody waits are kept and coalesce.
+// The waiter can check its condition under a lock and sleep without it, a signal sent after the check still wakes it.
+// Sleeps on an eventfd on Linux and an auto-reset event on Windows, which signaling only touches while the waiter sleeps.
+class WakeEvent
+{
+public:
+	WakeEvent();
+	WakeEvent(WakeEvent const&) = delete;
+	WakeEvent& operator=(WakeEvent const&) = delete;
+	~WakeEvent();
+
+	void Signal();
+	// Returns true and consumes the signal once signaled, false if timeout passed first. No timeout waits forever.
+	bool Wait(std::optional<std::chrono::nanoseconds> timeout = std::nullopt);
+	// Like Wait, but busy-waits without entering the kernel
+	bool Spin(std::chrono::steady_clock::time_point until);
+
+	// Like std::condition_variable::wait_until: releases lock while waiting, returns pred() once it holds or the deadline passed.
+	// Spins instead of sleeping inside the spin window.
+	template <typename Predicate>
+	bool WaitUntil(std::unique_lock<std::mutex>& lock, std::optional<std::chrono::steady_clock::time_point> deadline, Predicate pred, std::optional<SpinWindow> spin = std::nullopt)
+	{
+		while (!pred())
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (deadline && now >= *deadline)
+				return false;
+			lock.unlock();
+			if (spin && now >= spin->From && now < spin->Until)
+				Spin(deadline ? std::min(spin->Until, *deadline) : spin->Until);
+			else
+			{
+				// Wakes up in time to spin through the window
+				auto wakeAt = deadline;
+				if (spin && now < spin->From)
+					wakeAt = deadline ? std::min(*deadline, spin->From) : spin->From;
+				Wait(wakeAt ? std::optional(*wakeAt - now) : std::nullopt);
+			}
+			lock.lock();
+		}
+		return true;
+	}
+
+	template <typename Predicate>
+	bool WaitFor(std::unique_lock<std::mutex>& lock, std::chrono::nanoseconds timeout, Predicate pred, std::optional<SpinWindow> spin = std::nullopt)
+	{
+		return WaitUntil(lock, std::chrono::steady_clock::now() + timeout, pred, spin);
+	}
+
+	template <typename Predicate>
+	void Wait(std::unique_lock<std::mutex>& lock, Predicate pred, std::optional<SpinWindow> spin = std::nullopt)
+	{
+		WaitUntil(lock, std::nullopt, pred, spin);
+	}
+
+private:
+	// Waits for the OS object
+	bool Block(std::optional<std::chrono::nanoseconds> timeout);
+
+	std::atomic_bool Pending = false;
+	std::atomic_bool Sleeping = false;
+#if defined(_WIN32)
+	void* Event = nullptr;
+#else
+	int EventFd = -1;
+#endif
+};
+
+// Learns the interval between frame starts and its jitter, smoothed the way TCP estimates round-trip times,
+// to place a spin window around the next expected start. The window reaches 4 deviations to either side.
+class FrameStartPredictor
+{
+public:
+	// Intervals too irregular to fit maxHalfWidth to either side of the prediction get no window
+	explicit FrameStartPredictor(std::chrono::nanoseconds maxHalfWidth) : MaxHalfWidth(maxHalfWidth) {}
+
+	void OnFrameStart(std::chrono::steady_clock::time_point start);
+	std::optional<SpinWindow> GetSpinWindow() const;
+	void Reset();
+
+private:
+	std::chrono::nanoseconds MaxHalfWidth;
+	std::optional<std::chrono::steady_clock::time_point> LastStart;
+	// Smoothed interval and mean deviation in nanoseconds, 0 until two starts were seen
+	double Interval = 0;
+	double Deviation = 0;
+};
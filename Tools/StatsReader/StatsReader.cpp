@@ -0,0 +1,135 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+// Samples the counters an app started with --stats NAME publishes, without affecting its render threads.
+// Usage: NosOpenGLAppStats NAME [--interval MS] [--once]
+
+#include "Stats.h"
+#include "Log.h"
+
+#include <iostream>
+#include <iomanip>
+#include <charconv>
+#include <chrono>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// The writer holds a slot for a few dozen stores, spin until it is done
+static InstanceStats ReadSlot(StatsSlot const& slot)
+{
+	InstanceStats stats{};
+	while (!slot.TryRead(stats))
+		std::this_thread::yield();
+	return stats;
+}
+
+static void PrintTotals(uint32_t index, InstanceStats const& stats)
+{
+	std::cout << "Instance " << index << ": state " << stats.ExecutionState << ", frame " << stats.CurFrameNumber
+		<< " (Nodos " << stats.NodosFrameNumber << "), rendered " << stats.RenderedFrames << ", skipped " << stats.SkippedFrames << ", failed " << stats.FailedFrames
+		<< ", imported " << stats.TexturesImported << " textures and " << stats.BuffersImported << " buffers, " << stats.ImportFailures << " failed"
+		<< ", stalls " << stats.Stalls
+		<< ", memory " << (stats.ImportedBytes >> 20) << " MB imported and " << (stats.PooledBytes >> 20) << " MB pooled, "
+		<< stats.MemoryEvictions << " evictions, " << stats.BudgetRejections << " imports over budget" << std::endl;
+}
+
+static void PrintRates(uint32_t index, InstanceStats const& last, InstanceStats const& stats, double seconds)
+{
+	auto perSecond = [&](uint64_t InstanceStats::* counter) { return double(stats.*counter - last.*counter) / seconds; };
+	auto millisecondsPerSecond = [&](uint64_t InstanceStats::* counter) { return perSecond(counter) / 1e6; };
+	std::cout << std::fixed << std::setprecision(1)
+		<< "Instance " << index << ": " << perSecond(&InstanceStats::RenderedFrames) << " fps, "
+		<< perSecond(&InstanceStats::SkippedFrames) << " skipped/s, " << perSecond(&InstanceStats::FailedFrames) << " failed/s, Nodos ahead by " << int64_t(stats.NodosFrameNumber - stats.CurFrameNumber)
+		<< ", waiting for Nodos " << millisecondsPerSecond(&InstanceStats::ExecutionWaitNanoseconds) << " ms/s"
+		<< ", frame start latency " << (stats.FrameStartsSeen == last.FrameStartsSeen ? 0.0
+			: double(stats.FrameStartLatencyNanoseconds - last.FrameStartLatencyNanoseconds) / double(stats.FrameStartsSeen - last.FrameStartsSeen) / 1000) << " us"
+		<< ", semaphore " << millisecondsPerSecond(&InstanceStats::SemaphoreWaitNanoseconds) << " ms/s"
+		<< ", tasks " << perSecond(&InstanceStats::TasksProcessed) << "/s (" << stats.TaskQueueDepth << " queued)"
+		<< ", stalls " << stats.Stalls
+		<< ", GPU " << double(stats.GpuFrameMicroseconds) / 1000 << " ms at " << stats.ResolutionScalePercent << "%"
+		<< ", memory " << ((stats.ImportedBytes + stats.PooledBytes) >> 20) << " MB" << std::endl;
+}
+
+static void PrintMemoryTotal(std::vector<InstanceStats> const& instances)
+{
+	uint64_t imported = 0, pooled = 0;
+	for (auto& stats : instances)
+	{
+		imported += stats.ImportedBytes;
+		pooled += stats.PooledBytes;
+	}
+	std::cout << "All instances: " << ((imported + pooled) >> 20) << " MB, " << (imported >> 20) << " MB imported, " << (pooled >> 20) << " MB pooled" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	std::string name;
+	uint32_t intervalMs = 1000;
+	bool once = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		if (arg == "--once")
+			once = true;
+		else if (arg == "--interval" && i + 1 < argc)
+		{
+			std::string_view value = argv[++i];
+			auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), intervalMs);
+			if (ec != std::errc() || end != value.data() + value.size() || intervalMs == 0)
+			{
+				std::cerr << "Invalid value for --interval: " << value << std::endl;
+				return -1;
+			}
+		}
+		else if (name.empty() && !arg.starts_with("--"))
+			name = arg;
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " NAME [--interval MS] [--once]" << std::endl;
+			return -1;
+		}
+	}
+	if (name.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " NAME [--interval MS] [--once]" << std::endl;
+		return -1;
+	}
+
+	auto mapping = StatsMapping::Open(name);
+	if (!mapping)
+	{
+		FlushLog();
+		return -1;
+	}
+	auto& segment = *mapping->Segment;
+	uint32_t count = std::min(segment.InstanceCount, MaxStatsInstances);
+	std::cout << "Stats of process " << segment.ProcessId << ", " << count << " instance(s)" << std::endl;
+
+	std::vector<InstanceStats> last(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		last[i] = ReadSlot(segment.Instances[i]);
+		PrintTotals(i, last[i]);
+	}
+	PrintMemoryTotal(last);
+	if (once)
+		return 0;
+	auto lastTime = std::chrono::steady_clock::now();
+	while (true)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+		auto now = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(now - lastTime).count();
+		lastTime = now;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			auto stats = ReadSlot(segment.Instances[i]);
+			PrintRates(i, last[i], stats, seconds);
+			last[i] = stats;
+		}
+		if (count > 1)
+			PrintMemoryTotal(last);
+	}
+}